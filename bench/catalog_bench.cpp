@@ -0,0 +1,164 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Repo/patch catalog benchmark
+  *
+  * Resolves dependency edges on a synthetic network of 10k repos, once by
+  * walking the repo list the way SearchPatch() used to, and once through
+  * catalog_t. Doesn't need thcrap, so it also builds outside of Windows:
+  *
+  *   g++ -std=c++17 -O2 -Isrc bench/catalog_bench.cpp src/catalog.cpp src/sampler.cpp
+  */
+
+#include <chrono>
+#include <stdio.h>
+#include <string>
+#include <string.h>
+#include <vector>
+#include "catalog.h"
+#include "sampler.h"
+
+struct bench_repo_t
+{
+	std::string id;
+	std::vector<std::string> patches;
+};
+
+struct bench_edge_t
+{
+	uint32_t orig_repo;
+	// Empty for relative dependencies
+	std::string repo_id;
+	std::string patch_id;
+};
+
+static double ns_since(std::chrono::steady_clock::time_point start)
+{
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Same lookups as find_repo_in_list(), find_patch_in_repo() and
+// SearchPatch() in roulette.cpp
+static const bench_repo_t* linear_find_repo(const std::vector<bench_repo_t>& repos, const char* id)
+{
+	for (const bench_repo_t& repo : repos) {
+		if (strcmp(repo.id.c_str(), id) == 0) {
+			return &repo;
+		}
+	}
+	return nullptr;
+}
+
+static bool linear_has_patch(const bench_repo_t* repo, const char* patch_id)
+{
+	for (size_t i = 0; repo && i < repo->patches.size(); i++) {
+		if (strcmp(repo->patches[i].c_str(), patch_id) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static const bench_repo_t* linear_resolve(const std::vector<bench_repo_t>& repos, const bench_edge_t& edge)
+{
+	if (!edge.repo_id.empty()) {
+		const bench_repo_t* repo = linear_find_repo(repos, edge.repo_id.c_str());
+		return linear_has_patch(repo, edge.patch_id.c_str()) ? repo : nullptr;
+	}
+	const bench_repo_t* orig = linear_find_repo(repos, repos[edge.orig_repo].id.c_str());
+	if (linear_has_patch(orig, edge.patch_id.c_str())) {
+		return orig;
+	}
+	for (const bench_repo_t& repo : repos) {
+		if (linear_has_patch(&repo, edge.patch_id.c_str())) {
+			return &repo;
+		}
+	}
+	return nullptr;
+}
+
+static uint32_t catalog_resolve(const catalog_t& catalog, const std::vector<bench_repo_t>& repos, const bench_edge_t& edge)
+{
+	if (!edge.repo_id.empty()) {
+		uint32_t repo = catalog.find_repo(edge.repo_id);
+		return catalog.find_patch(repo, edge.patch_id) != CATALOG_NONE ? repo : CATALOG_NONE;
+	}
+	uint32_t orig = catalog.find_repo(repos[edge.orig_repo].id);
+	if (catalog.find_patch(orig, edge.patch_id) != CATALOG_NONE) {
+		return orig;
+	}
+	size_t count;
+	const uint32_t* owners = catalog.patch_owners(edge.patch_id, count);
+	return count ? owners[0] : CATALOG_NONE;
+}
+
+int main()
+{
+	const size_t REPOS = 10000;
+	const size_t PATCHES_PER_REPO = 20;
+	// Patch IDs are drawn from a shared pool, so that relative
+	// dependencies often live in another repo.
+	const size_t PATCH_POOL = 50000;
+	const size_t EDGES = 100000;
+	const size_t LINEAR_EDGES = 200;
+
+	rng_t rng(1);
+	std::vector<bench_repo_t> repos(REPOS);
+	for (size_t r = 0; r < REPOS; r++) {
+		repos[r].id = "repo" + std::to_string(r);
+		for (size_t p = 0; p < PATCHES_PER_REPO; p++) {
+			repos[r].patches.push_back("patch" + std::to_string(rng.below(PATCH_POOL)));
+		}
+	}
+
+	std::vector<bench_edge_t> edges(EDGES);
+	for (bench_edge_t& edge : edges) {
+		edge.orig_repo = (uint32_t)rng.below(REPOS);
+		if (rng.below(2)) {
+			const bench_repo_t& target = repos[rng.below(REPOS)];
+			edge.repo_id = target.id;
+			edge.patch_id = target.patches[rng.below(PATCHES_PER_REPO)];
+		}
+		else {
+			edge.patch_id = "patch" + std::to_string(rng.below(PATCH_POOL));
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	catalog_t catalog;
+	for (const bench_repo_t& repo : repos) {
+		uint32_t r = catalog.add_repo(repo.id);
+		for (const std::string& patch : repo.patches) {
+			catalog.add_patch(r, patch);
+		}
+	}
+	catalog.finish();
+	double build_ns = ns_since(start);
+
+	// Both have to agree on every edge
+	size_t mismatches = 0;
+	start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < LINEAR_EDGES; i++) {
+		const bench_repo_t* linear = linear_resolve(repos, edges[i]);
+		uint32_t indexed = catalog_resolve(catalog, repos, edges[i]);
+		mismatches += (linear ? (uint32_t)(linear - repos.data()) : CATALOG_NONE) != indexed;
+	}
+	double linear_ns = ns_since(start) / LINEAR_EDGES;
+
+	size_t found = 0;
+	start = std::chrono::steady_clock::now();
+	for (const bench_edge_t& edge : edges) {
+		found += catalog_resolve(catalog, repos, edge) != CATALOG_NONE;
+	}
+	double catalog_ns = ns_since(start) / EDGES;
+
+	printf("%zu repos, %zu patches\n", REPOS, REPOS * PATCHES_PER_REPO);
+	printf("catalog build:         %10.2f ms\n", build_ns / 1e6);
+	printf("linear walk per edge:  %10.1f ns (+ catalog lookup, %zu edges)\n", linear_ns, LINEAR_EDGES);
+	printf("catalog per edge:      %10.1f ns (%zu edges, %zu resolved)\n", catalog_ns, EDGES, found);
+	printf("mismatches:            %10zu\n", mismatches);
+	return mismatches ? 1 : 0;
+}
@@ -0,0 +1,458 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * End-to-end roll benchmark
+  *
+  * Generates a synthetic repo network, serves it through mock_transport_t
+  * as a stand-in for srv.thpatch.net, and times every phase of a roll the
+  * way roulette.cpp runs it. Prints the results as JSON, e.g.
+  *
+  *   roll_bench --repos 200 --latency 40 --jitter 20 --out roll.json
+  *
+  * --trace also writes a Chrome trace of the run, with every request.
+  *
+  * Resolution, the run configuration and the update run patch_graph_t,
+  * roll_runconfig_json() and roll_update() as they are. What the front end
+  * does around them with thcrap is left out: patch_init(), the patch
+  * entries of patch_to_runconfig_json(), and the local files.js.
+  */
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <string.h>
+#include <time.h>
+#include <unordered_map>
+#include <vector>
+#include "blacklist.h"
+#include "catalog.h"
+#include "crc32.h"
+#include "game_index.h"
+#include "patch_graph.h"
+#include "repo_crawl.h"
+#include "roll.h"
+#include "roll_update.h"
+#include "sel_stack.h"
+#include "trace.h"
+#include "transport_mock.h"
+
+namespace fs = std::filesystem;
+
+#define BENCH_HOST "https://bench.invalid/"
+
+struct bench_options_t
+{
+	size_t repos = 50;
+	size_t patches = 10;
+	size_t files = 20;
+	size_t file_size = 4096;
+	// Dependencies of every patch that isn't at the bottom of a chain
+	size_t fanout = 2;
+	// Length of the longest dependency chain
+	size_t depth = 3;
+	// repo.js neighbors of every repo
+	size_t neighbors = 3;
+	// Games in the network, and games touched by every patch
+	size_t games = 8;
+	size_t games_per_patch = 2;
+	size_t picks = 5;
+	mock_transport_options_t network;
+	unsigned jobs = 8;
+	uint64_t seed = 1;
+	const char* out = nullptr;
+	const char* trace = nullptr;
+};
+
+// Bodies of files aren't kept in memory, but generated again from their
+// seed whenever they're requested.
+class bench_origin_t : public transport_t
+{
+public:
+	size_t file_size = 0;
+	std::unordered_map<std::string, uint64_t> seeds;
+
+	HttpStatus stream(const char* url, const download_chunk_func_t& on_chunk) override
+	{
+		auto it = seeds.find(url);
+		if (it == seeds.end()) {
+			return HttpClientError;
+		}
+		std::vector<uint8_t> body = file_body(it->second, file_size);
+		return on_chunk(body.data(), body.size()) ? HttpOk : HttpCancelled;
+	}
+
+	static std::vector<uint8_t> file_body(uint64_t seed, size_t size)
+	{
+		std::vector<uint8_t> body(size);
+		rng_t rng(seed);
+		for (size_t i = 0; i < size; i += 8) {
+			uint64_t x = rng.next();
+			memcpy(&body[i], &x, size - i < 8 ? size - i : 8);
+		}
+		return body;
+	}
+};
+
+static std::string repo_id(size_t r)
+{
+	return "repo" + std::to_string(r);
+}
+
+static std::string patch_id(size_t p)
+{
+	return "patch" + std::to_string(p);
+}
+
+static std::string repo_server(size_t r)
+{
+	return BENCH_HOST + repo_id(r) + "/";
+}
+
+// Every repo links to [neighbors] others, starting with the next one in
+// order, so that discovery always reaches the whole network. Patches of
+// every repo are stacked in chains of [depth]: a patch depends on the one
+// below it in its own repo, and on [fanout] - 1 patches at that same
+// level of other repos.
+static void generate_network(const bench_options_t& options, const game_table_t& games, mock_transport_t& mock, bench_origin_t& origin)
+{
+	rng_t rng(options.seed);
+	size_t levels = options.depth + 1;
+	for (size_t r = 0; r < options.repos; r++) {
+		std::string repo_js = "{\"id\": \"" + repo_id(r) + "\", \"title\": \"Repo " + std::to_string(r) + "\", ";
+		repo_js += "\"servers\": [\"" + repo_server(r) + "\"], \"neighbors\": [";
+		for (size_t n = 0; n < options.neighbors && n + 1 < options.repos; n++) {
+			size_t neighbor = n == 0 ? (r + 1) % options.repos : (size_t)rng.below(options.repos);
+			repo_js += (n ? ", \"" : "\"") + repo_server(neighbor) + "\"";
+		}
+		repo_js += "], \"patches\": {";
+		for (size_t p = 0; p < options.patches; p++) {
+			repo_js += (p ? ", \"" : "\"") + patch_id(p) + "\": \"Patch " + std::to_string(p) + "\"";
+		}
+		repo_js += "}}";
+		mock.add(repo_server(r) + "repo.js", repo_js);
+
+		for (size_t p = 0; p < options.patches; p++) {
+			std::string base = repo_server(r) + patch_id(p) + "/";
+			std::string patch_js = "{\"id\": \"" + patch_id(p) + "\", \"dependencies\": [";
+			if (p % levels != 0) {
+				patch_js += "\"" + patch_id(p - 1) + "\"";
+				for (size_t d = 1; d < options.fanout; d++) {
+					size_t target = (size_t)rng.below(options.repos);
+					patch_js += ", \"" + repo_id(target) + "/" + patch_id(p - 1) + "\"";
+				}
+			}
+			patch_js += "]}";
+			mock.add(base + "patch.js", patch_js);
+
+			// Roughly one file in (games_per_patch + 1) isn't game-specific
+			std::vector<size_t> patch_games;
+			for (size_t g = 0; g < options.games_per_patch; g++) {
+				patch_games.push_back((size_t)rng.below(options.games));
+			}
+			std::string files_js = "{";
+			for (size_t f = 0; f < options.files; f++) {
+				size_t pick = (size_t)rng.below(patch_games.size() + 1);
+				std::string fn = "file" + std::to_string(f) + ".dat";
+				if (pick < patch_games.size()) {
+					fn = games[patch_games[pick]] + "/" + fn;
+				}
+				uint64_t seed = rng.next();
+				std::vector<uint8_t> body = bench_origin_t::file_body(seed, options.file_size);
+				origin.seeds[base + fn] = seed;
+				files_js += (f ? ", \"" : "\"") + fn + "\": " + std::to_string(crc32_calc(body.data(), body.size()));
+			}
+			files_js += "}";
+			mock.add(base + "files.js", files_js);
+		}
+	}
+
+	std::string blacklist_js = "{"
+		"\"repo_exclude\": [\"" + repo_id(options.repos - 1) + "\"], "
+		"\"patch_exclude\": [\"debug_*\"], "
+		"\"repo_weights\": {\"" + repo_id(0) + "\": 4}, "
+		"\"patch_weights\": {\"" + patch_id(0) + "\": 0.5}"
+		"}";
+	mock.add(BENCH_HOST "blacklist.json", blacklist_js);
+}
+
+struct bench_phase_t
+{
+	const char* name;
+	double ms;
+};
+
+// Also records every phase as a span, if tracing
+class bench_timer_t
+{
+public:
+	std::vector<bench_phase_t> phases;
+
+	void start(const char* name)
+	{
+		phase_name = name;
+		span.emplace(name);
+		phase_start = std::chrono::steady_clock::now();
+	}
+
+	void stop()
+	{
+		auto now = std::chrono::steady_clock::now();
+		span.reset();
+		phases.push_back({ phase_name, std::chrono::duration<double, std::milli>(now - phase_start).count() });
+	}
+
+private:
+	const char* phase_name = nullptr;
+	std::optional<trace_span_t> span;
+	std::chrono::steady_clock::time_point phase_start;
+};
+
+static bool parse_args(int argc, char** argv, bench_options_t& options)
+{
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing value for %s\n", arg);
+			return false;
+		}
+		const char* value = argv[++i];
+		if (!strcmp(arg, "--repos")) options.repos = strtoull(value, nullptr, 10);
+		else if (!strcmp(arg, "--patches")) options.patches = strtoull(value, nullptr, 10);
+		else if (!strcmp(arg, "--files")) options.files = strtoull(value, nullptr, 10);
+		else if (!strcmp(arg, "--file-size")) options.file_size = strtoull(value, nullptr, 10);
+		else if (!strcmp(arg, "--fanout")) options.fanout = strtoull(value, nullptr, 10);
+		else if (!strcmp(arg, "--depth")) options.depth = strtoull(value, nullptr, 10);
+		else if (!strcmp(arg, "--neighbors")) options.neighbors = strtoull(value, nullptr, 10);
+		else if (!strcmp(arg, "--games")) options.games = strtoull(value, nullptr, 10);
+		else if (!strcmp(arg, "--games-per-patch")) options.games_per_patch = strtoull(value, nullptr, 10);
+		else if (!strcmp(arg, "--picks")) options.picks = strtoull(value, nullptr, 10);
+		else if (!strcmp(arg, "--latency")) options.network.latency_ms = atof(value);
+		else if (!strcmp(arg, "--jitter")) options.network.jitter_ms = atof(value);
+		else if (!strcmp(arg, "--bandwidth")) options.network.bandwidth = atof(value) * 1024.0;
+		else if (!strcmp(arg, "--error-rate")) options.network.error_rate = atof(value);
+		else if (!strcmp(arg, "--jobs")) options.jobs = (unsigned)strtoul(value, nullptr, 10);
+		else if (!strcmp(arg, "--seed")) options.seed = strtoull(value, nullptr, 10);
+		else if (!strcmp(arg, "--out")) options.out = value;
+		else if (!strcmp(arg, "--trace")) options.trace = value;
+		else {
+			fprintf(stderr, "Unknown option %s\n", arg);
+			return false;
+		}
+	}
+	if (options.repos < 2 || options.patches == 0 || options.games == 0 || options.jobs == 0) {
+		fprintf(stderr, "Need at least 2 repos, 1 patch, 1 game and 1 job\n");
+		return false;
+	}
+	options.network.seed = options.seed;
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	bench_options_t options;
+	if (!parse_args(argc, argv, options)) {
+		return 2;
+	}
+
+	game_index_t index;
+	if (options.games > index.games.size()) {
+		options.games = index.games.size();
+	}
+	bench_origin_t origin;
+	origin.file_size = options.file_size;
+	mock_transport_t mock(options.network, &origin);
+	generate_network(options, index.games, mock, origin);
+	transport_use(&mock);
+
+	rng_t rng(options.seed);
+	int game_bit = (int)rng.below(options.games);
+	fs::path out_dir = fs::temp_directory_path() / ("roll_bench_" + std::to_string(options.seed));
+	bench_timer_t timer;
+	if (options.trace) {
+		trace_start();
+	}
+
+	/// Blacklist
+	timer.start("blacklist");
+	exclusion_set_t repo_exclude;
+	exclusion_set_t patch_exclude;
+	roll_weights_t weights;
+	std::vector<uint8_t> blacklist_js;
+	if (download_to_memory(BENCH_HOST "blacklist.json", blacklist_js) == HttpOk) {
+		blacklist_parse(blacklist_js.data(), blacklist_js.size(), repo_exclude, patch_exclude, weights);
+	}
+	timer.stop();
+
+	/// Discovery
+	timer.start("discovery");
+	std::vector<repo_info_t> repos = repo_crawl((BENCH_HOST + repo_id(0)).c_str(), options.jobs);
+	catalog_t catalog;
+	for (const repo_info_t& repo : repos) {
+		uint32_t r = catalog.add_repo(repo.id);
+		for (const repo_patch_info_t& patch : repo.patches) {
+			catalog.add_patch(r, patch.id);
+		}
+	}
+	catalog.finish();
+	timer.stop();
+
+	/// Game filter
+	timer.start("game_filter");
+	std::vector<roll_candidate_t> candidates;
+	for (uint32_t r = 0; r < repos.size(); r++) {
+		for (const repo_patch_info_t& patch : repos[r].patches) {
+			candidates.push_back({ r, repos[r].id.c_str(), patch.id.c_str() });
+		}
+	}
+	roll_exclude(candidates, repo_exclude, patch_exclude);
+	std::vector<std::vector<const char*>> servers(repos.size());
+	for (size_t r = 0; r < repos.size(); r++) {
+		for (const std::string& server : repos[r].servers) {
+			servers[r].push_back(server.c_str());
+		}
+		servers[r].push_back(nullptr);
+	}
+	std::vector<game_index_source_t> sources;
+	for (const roll_candidate_t& c : candidates) {
+		sources.push_back({ c.repo_id, c.patch_id, nullptr, servers[c.repo].data() });
+	}
+	index.covered = index.games.all();
+	int64_t now = (int64_t)time(nullptr);
+	std::vector<size_t> stale = game_index_stale(index, sources, now, 0);
+	game_index_update(index, sources, stale, now, options.jobs);
+	size_t indexed = candidates.size();
+	roll_filter_game(candidates, index, game_bit);
+	timer.stop();
+
+	/// Sampling
+	timer.start("sampling");
+	std::vector<double> candidate_weights = roll_apply_weights(candidates, weights);
+	size_t picks = options.picks < candidates.size() ? options.picks : candidates.size();
+	roll_pick(candidates, std::move(candidate_weights), picks, rng);
+	timer.stop();
+
+	/// Resolution
+	timer.start("resolution");
+	arena_t arena;
+	patch_graph_t graph(catalog, [&](uint32_t repo) { return servers[repo].data(); }, arena);
+	std::vector<uint32_t> roots;
+	for (const roll_candidate_t& pick : candidates) {
+		roots.push_back(graph.node(pick.repo_id, pick.patch_id));
+	}
+	graph.prefetch(roots, options.jobs);
+	sel_stack_t stack;
+	int resolve_errors = 0;
+	for (uint32_t root : roots) {
+		resolve_errors += graph.add(root, stack, {});
+	}
+	timer.stop();
+
+	/// Config write
+	timer.start("config_write");
+	std::string run_cfg = roll_runconfig_json(stack, index.games[game_bit].c_str(), [](const char* repo_id, const char* patch_id) {
+		return std::string("{\"archive\": \"repos/") + repo_id + "/" + patch_id + "/\"}";
+	});
+	{
+		fs::path cfg_path = out_dir / "config" / "random.js";
+		std::error_code ec;
+		fs::create_directories(cfg_path.parent_path(), ec);
+		std::ofstream file(cfg_path, std::ios::binary);
+		file << run_cfg;
+	}
+	timer.stop();
+
+	/// Update
+	timer.start("update");
+	std::vector<roll_update_patch_t> update_patches(stack.size());
+	for (size_t i = 0; i < stack.size(); i++) {
+		roll_update_patch_t& p = update_patches[i];
+		uint32_t r = catalog.find_repo(stack.repo_id(i));
+		p.id = stack.patch_id(i);
+		p.archive = (out_dir / stack.repo_id(i) / p.id).u8string() + "/";
+		for (const std::string& server : repos[r].servers) {
+			p.servers.push_back(server + p.id + "/");
+		}
+	}
+	double launchable_ms = 0.0;
+	auto update_start = std::chrono::steady_clock::now();
+	roll_update_t update;
+	update.jobs = options.jobs;
+	update.games = &index.games;
+	update.game_bit = game_bit;
+	update.on_launchable = [&](size_t) {
+		launchable_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - update_start).count();
+	};
+	roll_update_stats_t update_stats = roll_update(update_patches, update);
+	timer.stop();
+
+	transport_use(nullptr);
+	if (options.trace) {
+		std::string trace = trace_stop();
+		std::ofstream file(fs::u8path(options.trace), std::ios::binary);
+		file << trace;
+	}
+	std::error_code ec;
+	fs::remove_all(out_dir, ec);
+
+	/// Report
+	mock_transport_t::stats_t network = mock.stats();
+	double total_ms = 0.0;
+	std::string json = "{\n  \"config\": {";
+	json += "\"repos\": " + std::to_string(options.repos);
+	json += ", \"patches\": " + std::to_string(options.patches);
+	json += ", \"files\": " + std::to_string(options.files);
+	json += ", \"file_size\": " + std::to_string(options.file_size);
+	json += ", \"fanout\": " + std::to_string(options.fanout);
+	json += ", \"depth\": " + std::to_string(options.depth);
+	json += ", \"neighbors\": " + std::to_string(options.neighbors);
+	json += ", \"games\": " + std::to_string(options.games);
+	json += ", \"games_per_patch\": " + std::to_string(options.games_per_patch);
+	json += ", \"picks\": " + std::to_string(options.picks);
+	json += ", \"latency_ms\": " + std::to_string(options.network.latency_ms);
+	json += ", \"jitter_ms\": " + std::to_string(options.network.jitter_ms);
+	json += ", \"bandwidth\": " + std::to_string(options.network.bandwidth);
+	json += ", \"error_rate\": " + std::to_string(options.network.error_rate);
+	json += ", \"jobs\": " + std::to_string(options.jobs);
+	json += ", \"seed\": " + std::to_string(options.seed);
+	json += "},\n  \"phases_ms\": {";
+	for (size_t i = 0; i < timer.phases.size(); i++) {
+		json += (i ? ", \"" : "\"") + std::string(timer.phases[i].name) + "\": " + std::to_string(timer.phases[i].ms);
+		total_ms += timer.phases[i].ms;
+	}
+	json += ", \"total\": " + std::to_string(total_ms);
+	json += "},\n  \"counters\": {";
+	json += "\"game\": \"" + index.games[game_bit] + "\"";
+	json += ", \"repos_discovered\": " + std::to_string(repos.size());
+	json += ", \"patches_indexed\": " + std::to_string(indexed);
+	json += ", \"candidates\": " + std::to_string(candidates.size());
+	json += ", \"stack\": " + std::to_string(stack.size());
+	json += ", \"resolve_errors\": " + std::to_string(resolve_errors);
+	json += ", \"update_files\": " + std::to_string(update_stats.files);
+	json += ", \"downloaded\": " + std::to_string(update_stats.downloaded);
+	json += ", \"downloaded_bytes\": " + std::to_string(update_stats.downloaded_bytes);
+	json += ", \"deduplicated\": " + std::to_string(update_stats.deduplicated);
+	json += ", \"failed\": " + std::to_string(update_stats.failed);
+	json += ", \"launchable_ms\": " + std::to_string(launchable_ms);
+	json += ", \"requests\": " + std::to_string(network.requests);
+	json += ", \"requests_failed\": " + std::to_string(network.failed);
+	json += ", \"network_bytes\": " + std::to_string(network.bytes);
+	json += "}\n}\n";
+
+	if (options.out) {
+		std::ofstream file(fs::u8path(options.out), std::ios::binary);
+		file << json;
+		if (!file) {
+			fprintf(stderr, "Couldn't write %s\n", options.out);
+			return 1;
+		}
+	}
+	fputs(json.c_str(), stdout);
+	return 0;
+}
@@ -0,0 +1,60 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Weighted sampler benchmark
+  *
+  * Shows that neither the cost of a draw nor that of removing the drawn
+  * candidate grows with the number of candidates. Doesn't need thcrap, so it also builds outside of Windows:
+  *
+  *   g++ -std=c++17 -O2 -Isrc bench/sampler_bench.cpp src/sampler.cpp
+  */
+
+#include <chrono>
+#include <stdio.h>
+#include "sampler.h"
+
+static double ns_since(std::chrono::steady_clock::time_point start)
+{
+	return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	const size_t DRAWS = 1000000;
+	const size_t REMOVES = 1000;
+
+	printf("%10s %12s %12s %12s\n", "candidates", "build (ms)", "draw (ns)", "remove (ns)");
+	for (size_t n = 1000; n <= 1000000; n *= 10) {
+		rng_t rng(n);
+		std::vector<double> weights(n);
+		for (double& w : weights) {
+			w = 0.1 + rng.unit() * 10.0;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		weighted_sampler_t sampler(weights);
+		double build_ns = ns_since(start);
+
+		// Summed, so that the draws can't be optimized out
+		size_t sum = 0;
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < DRAWS; i++) {
+			sum += sampler.draw(rng);
+		}
+		double draw_ns = ns_since(start) / DRAWS;
+
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < REMOVES; i++) {
+			size_t picked = sampler.draw(rng);
+			sum += picked;
+			sampler.remove(picked);
+		}
+		double remove_ns = ns_since(start) / REMOVES;
+
+		printf("%10zu %12.2f %12.1f %12.1f%s\n", n, build_ns / 1e6, draw_ns, remove_ns, sum ? "" : " ");
+	}
+	return 0;
+}
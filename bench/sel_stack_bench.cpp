@@ -0,0 +1,120 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Selection stack benchmark
+  *
+  * Builds selection stacks of 1k to 16k patches the way patch_graph_t does,
+  * with a membership test for every dependency edge, once with the
+  * std::list and sel_match() scan from thcrap_configure, and once with
+  * sel_stack_t. Doesn't need thcrap, so it also builds outside of Windows:
+  *
+  *   g++ -std=c++17 -O2 -Isrc bench/sel_stack_bench.cpp src/sel_stack.cpp src/catalog.cpp src/sampler.cpp
+  */
+
+#include <chrono>
+#include <list>
+#include <stdio.h>
+#include <string>
+#include <string.h>
+#include <vector>
+#include "sel_stack.h"
+#include "sampler.h"
+
+struct bench_desc_t
+{
+	const char* repo_id;
+	const char* patch_id;
+};
+
+static bool sel_match(const bench_desc_t& a, const bench_desc_t& b)
+{
+	bool absolute = a.repo_id && b.repo_id;
+	bool repo_match = absolute ? strcmp(a.repo_id, b.repo_id) == 0 : true;
+	return repo_match && strcmp(a.patch_id, b.patch_id) == 0;
+}
+
+static bool list_contains(const std::list<bench_desc_t>& stack, const bench_desc_t& sel)
+{
+	for (const bench_desc_t& it : stack) {
+		if (sel_match(sel, it)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static double ms_since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+	const size_t DEPS_PER_PATCH = 4;
+	const size_t REPOS = 200;
+
+	std::vector<std::string> repo_ids;
+	for (size_t r = 0; r < REPOS; r++) {
+		repo_ids.push_back("repo" + std::to_string(r));
+	}
+
+	int mismatches = 0;
+	printf("%8s %14s %14s\n", "entries", "list (ms)", "sel_stack (ms)");
+	for (size_t entries : { 1000, 4000, 16000 }) {
+		rng_t rng(entries);
+		std::vector<std::string> patch_ids;
+		for (size_t p = 0; p < entries * 2; p++) {
+			patch_ids.push_back("patch" + std::to_string(p));
+		}
+
+		// Pushed patches, and the dependencies checked before each push.
+		// Half of them relative, about half of them already selected.
+		std::vector<bench_desc_t> pushes;
+		std::vector<bench_desc_t> queries;
+		for (size_t i = 0; i < entries; i++) {
+			pushes.push_back({ repo_ids[rng.below(REPOS)].c_str(), patch_ids[i * 2].c_str() });
+			for (size_t d = 0; d < DEPS_PER_PATCH; d++) {
+				const char* repo_id = rng.below(2) ? repo_ids[rng.below(REPOS)].c_str() : nullptr;
+				queries.push_back({ repo_id, patch_ids[rng.below(i * 2 + 2)].c_str() });
+			}
+		}
+
+		std::vector<bool> list_results;
+		auto start = std::chrono::steady_clock::now();
+		std::list<bench_desc_t> list;
+		for (size_t i = 0; i < entries; i++) {
+			for (size_t d = 0; d < DEPS_PER_PATCH; d++) {
+				list_results.push_back(list_contains(list, queries[i * DEPS_PER_PATCH + d]));
+			}
+			list.push_back({ strdup(pushes[i].repo_id), strdup(pushes[i].patch_id) });
+		}
+		double list_ms = ms_since(start);
+
+		std::vector<bool> stack_results;
+		start = std::chrono::steady_clock::now();
+		sel_stack_t stack;
+		for (size_t i = 0; i < entries; i++) {
+			for (size_t d = 0; d < DEPS_PER_PATCH; d++) {
+				const bench_desc_t& query = queries[i * DEPS_PER_PATCH + d];
+				stack_results.push_back(stack.contains(query.repo_id, query.patch_id));
+			}
+			stack.push(pushes[i].repo_id, pushes[i].patch_id);
+		}
+		double stack_ms = ms_since(start);
+
+		mismatches += list_results != stack_results;
+		for (size_t i = 0; i < stack.size(); i++) {
+			mismatches += strcmp(stack.patch_id(i), pushes[i].patch_id) != 0;
+		}
+		for (bench_desc_t& sel : list) {
+			free((void*)sel.repo_id);
+			free((void*)sel.patch_id);
+		}
+		printf("%8zu %14.2f %14.2f\n", entries, list_ms, stack_ms);
+	}
+	printf("mismatches: %d\n", mismatches);
+	return mismatches ? 1 : 0;
+}
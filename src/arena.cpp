@@ -0,0 +1,81 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Bump allocator for roll-time data
+  */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+void* arena_t::alloc(size_t size, size_t align)
+{
+	counters.allocations++;
+	counters.bytes += size;
+
+	size_t pad = (align - (uintptr_t)cur % align) % align;
+	if (!cur || pad + size > left) {
+		// Big allocations get a block of their own, so that they don't
+		// waste the rest of the current one.
+		size_t new_size = size + align > block_size / 4 ? size + align : block_size;
+		char* block = (char*)malloc(new_size);
+		if (!block) {
+			return nullptr;
+		}
+		blocks.push_back(block);
+		held += new_size;
+		if (held > counters.peak_bytes) {
+			counters.peak_bytes = held;
+		}
+		pad = (align - (uintptr_t)block % align) % align;
+		if (new_size != block_size) {
+			return block + pad;
+		}
+		cur = block;
+		left = new_size;
+	}
+	void* ret = cur + pad;
+	cur += pad + size;
+	left -= pad + size;
+	return ret;
+}
+
+char* arena_t::copy(std::string_view str)
+{
+	char* ret = (char*)alloc(str.size() + 1, 1);
+	if (ret) {
+		memcpy(ret, str.data(), str.size());
+		ret[str.size()] = '\0';
+	}
+	return ret;
+}
+
+const char* arena_t::intern(std::string_view str)
+{
+	auto it = interned.find(str);
+	if (it != interned.end()) {
+		return it->data();
+	}
+	char* ret = copy(str);
+	if (ret) {
+		interned.emplace(ret, str.size());
+	}
+	return ret;
+}
+
+void arena_t::release()
+{
+	for (char* block : blocks) {
+		free(block);
+	}
+	blocks.clear();
+	interned.clear();
+	cur = nullptr;
+	left = 0;
+	held = 0;
+	counters = stats_t();
+}
@@ -0,0 +1,53 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Bump allocator for roll-time data
+  */
+
+#pragma once
+
+#include <stddef.h>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Hands out memory from large blocks that are only given back all at once,
+// by release() or the destructor. Not thread-safe.
+class arena_t
+{
+public:
+	struct stats_t
+	{
+		// Since the last release()
+		size_t allocations = 0;
+		size_t bytes = 0;
+		// Most block memory held at once since the last release()
+		size_t peak_bytes = 0;
+	};
+
+	explicit arena_t(size_t block_size = 64 * 1024) : block_size(block_size) {}
+	arena_t(const arena_t&) = delete;
+	arena_t& operator=(const arena_t&) = delete;
+	~arena_t() { release(); }
+
+	void* alloc(size_t size, size_t align = alignof(max_align_t));
+	// \0-terminated copy of [str]
+	char* copy(std::string_view str);
+	// Same as copy(), but equal strings share one copy.
+	const char* intern(std::string_view str);
+	void release();
+
+	const stats_t& stats() const { return counters; }
+
+private:
+	size_t block_size;
+	std::vector<char*> blocks;
+	char* cur = nullptr;
+	size_t left = 0;
+	size_t held = 0;
+	std::unordered_set<std::string_view> interned;
+	stats_t counters;
+};
@@ -0,0 +1,76 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Default exclusions and weights
+  */
+
+#include <stdlib.h>
+#include <string>
+#include "blacklist.h"
+#include "json_stream.h"
+
+bool blacklist_parse(const void* data, size_t size, exclusion_set_t& repo_exclude, exclusion_set_t& patch_exclude, roll_weights_t& weights)
+{
+	exclusion_set_t* exclude = nullptr;
+	std::unordered_map<std::string, double>* section_weights = nullptr;
+	std::string weight_key;
+	bool weight_key_valid = false;
+	bool is_object = false;
+
+	json_stream_t stream;
+	json_token_func_t on_token = [&](const json_token_t& token) {
+		if (token.depth == 0) {
+			is_object = token.type == JSON_TOKEN_OBJECT_BEGIN || token.type == JSON_TOKEN_OBJECT_END;
+			return is_object;
+		}
+		if (token.depth == 1) {
+			switch (token.type) {
+			case JSON_TOKEN_KEY:
+				exclude = token.text == "repo_exclude" ? &repo_exclude
+					: token.text == "patch_exclude" ? &patch_exclude
+					: nullptr;
+				section_weights = token.text == "repo_weights" ? &weights.repos
+					: token.text == "patch_weights" ? &weights.patches
+					: nullptr;
+				break;
+			// Exclusions have to be arrays, and weights objects
+			case JSON_TOKEN_ARRAY_BEGIN:
+				section_weights = nullptr;
+				break;
+			case JSON_TOKEN_OBJECT_BEGIN:
+				exclude = nullptr;
+				break;
+			case JSON_TOKEN_ARRAY_END:
+			case JSON_TOKEN_OBJECT_END:
+				break;
+			default:
+				exclude = nullptr;
+				section_weights = nullptr;
+			}
+			return true;
+		}
+		if (token.depth != 2) {
+			return true;
+		}
+		// A cut-off ID would exclude or weigh something else
+		if (exclude && token.type == JSON_TOKEN_STRING && !token.truncated) {
+			exclude->add(token.text);
+		}
+		else if (section_weights && token.type == JSON_TOKEN_KEY) {
+			weight_key = token.text;
+			weight_key_valid = !token.truncated;
+		}
+		else if (section_weights && token.type == JSON_TOKEN_NUMBER && weight_key_valid) {
+			double weight = atof(std::string(token.text).c_str());
+			if (weight >= 0.0) {
+				(*section_weights)[weight_key] = weight;
+			}
+		}
+		return true;
+	};
+	stream.feed((const char*)data, size, on_token);
+	return stream.finish(on_token) && is_object;
+}
@@ -0,0 +1,28 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Default exclusions and weights
+  */
+
+#pragma once
+
+#include <stddef.h>
+#include "exclusion.h"
+#include "roll.h"
+
+#define BLACKLIST_URL "https://raw.githubusercontent.com/touhoureplayshowcase/thcrap_roulette/master/blacklist.json"
+
+// Reads a blacklist.json:
+//   {
+//     "repo_exclude": ["<repo_id>", ...],
+//     "patch_exclude": ["<patch_id>", ...],
+//     "repo_weights": { "<repo_id>": <weight>, ... },
+//     "patch_weights": { "<[repo_id/]patch_id>": <weight>, ... }
+//   }
+// and adds its entries to the given sets. Every section is optional, and
+// negative weights are ignored. Returns false if [data] isn't a JSON
+// object. Entries read before an error are kept.
+bool blacklist_parse(const void* data, size_t size, exclusion_set_t& repo_exclude, exclusion_set_t& patch_exclude, roll_weights_t& weights);
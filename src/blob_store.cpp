@@ -0,0 +1,262 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Content-addressed file store
+  */
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <inttypes.h>
+#include <stdio.h>
+#include "blob_store.h"
+
+// Every path in the store is plain ASCII, so the narrow standard library
+// functions are fine even on Windows.
+namespace fs = std::filesystem;
+
+static bool read_whole_file(const std::string& path, std::vector<uint8_t>& out, uint64_t size)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file) {
+		return false;
+	}
+	out.resize((size_t)size);
+	bool ok = fread(out.data(), 1, out.size(), file) == out.size() && fgetc(file) == EOF;
+	fclose(file);
+	return ok;
+}
+
+blob_store_t::blob_store_t(std::string dir, uint64_t max_bytes)
+	: dir(std::move(dir)), max_bytes(max_bytes)
+{
+}
+
+std::string blob_store_t::blob_path(const std::string& name) const
+{
+	return dir + "/" + name;
+}
+
+std::string blob_store_t::index_path() const
+{
+	return dir + "/index.txt";
+}
+
+void blob_store_t::load()
+{
+	std::scoped_lock lock(mutex);
+	blobs.clear();
+	files.clear();
+	total = 0;
+	clock = 0;
+
+	// One "blob <SHA-256> <size> <last used>" line per blob, and one
+	// "fn <CRC32> <SHA-256> <path>" line per file, with the numbers in hex.
+	// Anything else, like the lines of older versions that were keyed on
+	// the CRC32 alone or on the full archive path, is skipped, and gc()
+	// deletes the blobs they pointed to.
+	std::ifstream file(index_path());
+	std::string line;
+	while (std::getline(file, line)) {
+		char hex[65];
+		uint32_t crc32;
+		uint64_t size;
+		uint64_t last_used;
+		int fn_start = 0;
+		sha256_t hash;
+		if (sscanf(line.c_str(), "blob %64s %" SCNx64 " %" SCNx64, hex, &size, &last_used) == 3 && sha256_parse(hex, hash)) {
+			std::string name = sha256_hex(hash);
+			std::error_code ec;
+			if (fs::file_size(blob_path(name), ec) != size || ec) {
+				continue;
+			}
+			if (blobs.emplace(name, blob_t{ size, last_used }).second) {
+				total += size;
+			}
+			clock = std::max(clock, last_used);
+		}
+		else if (sscanf(line.c_str(), "fn %" SCNx32 " %64s %n", &crc32, hex, &fn_start) == 2 && fn_start && sha256_parse(hex, hash)) {
+			files[{ crc32, line.substr(fn_start) }] = hash;
+		}
+	}
+	// Files whose blob is gone
+	for (auto it = files.begin(); it != files.end();) {
+		it = blobs.count(sha256_hex(it->second)) ? std::next(it) : files.erase(it);
+	}
+}
+
+bool blob_store_t::save()
+{
+	std::scoped_lock lock(mutex);
+	if (blobs.empty() && !fs::exists(dir)) {
+		return true;
+	}
+	evict(max_bytes);
+
+	std::string tmp = index_path() + ".tmp";
+	FILE* file = fopen(tmp.c_str(), "w");
+	if (!file) {
+		return false;
+	}
+	for (const auto& [name, blob] : blobs) {
+		fprintf(file, "blob %s %" PRIx64 " %" PRIx64 "\n", name.c_str(), blob.size, blob.last_used);
+	}
+	for (const auto& [key, hash] : files) {
+		fprintf(file, "fn %08" PRIx32 " %s %s\n", key.first, sha256_hex(hash).c_str(), key.second.c_str());
+	}
+	bool ok = fclose(file) == 0;
+	std::error_code ec;
+	fs::rename(tmp, index_path(), ec);
+	return ok && !ec;
+}
+
+bool blob_store_t::get(const std::string& fn, uint32_t crc32, std::vector<uint8_t>& out)
+{
+	std::string name;
+	uint64_t size = 0;
+	sha256_t hash;
+	{
+		std::scoped_lock lock(mutex);
+		auto file = files.find({ crc32, fn });
+		if (file != files.end()) {
+			hash = file->second;
+			name = sha256_hex(hash);
+			auto blob = blobs.find(name);
+			if (blob != blobs.end()) {
+				size = blob->second.size;
+			}
+			else {
+				name.clear();
+			}
+		}
+	}
+	if (!name.empty() && read_whole_file(blob_path(name), out, size) && sha256_calc(out.data(), out.size()) == hash) {
+		std::scoped_lock lock(mutex);
+		auto blob = blobs.find(name);
+		if (blob != blobs.end()) {
+			blob->second.last_used = ++clock;
+		}
+		counters.hits++;
+		return true;
+	}
+	std::scoped_lock lock(mutex);
+	counters.misses++;
+	return false;
+}
+
+void blob_store_t::put(const std::string& fn, uint32_t crc32, const void* data, size_t size)
+{
+	sha256_t hash = sha256_calc(data, size);
+	std::string name = sha256_hex(hash);
+	bool stored;
+	{
+		std::scoped_lock lock(mutex);
+		files[{ crc32, fn }] = hash;
+		auto blob = blobs.find(name);
+		stored = blob != blobs.end();
+		if (stored) {
+			blob->second.last_used = ++clock;
+		}
+	}
+	if (stored) {
+		return;
+	}
+
+	// Written under a temporary name first, so that a blob file is
+	// always complete.
+	std::string path = blob_path(name);
+	std::string tmp = path + ".tmp";
+	std::error_code ec;
+	fs::create_directories(dir, ec);
+	FILE* file = fopen(tmp.c_str(), "wb");
+	if (!file) {
+		return;
+	}
+	bool ok = fwrite(data, 1, size, file) == size;
+	ok = fclose(file) == 0 && ok;
+	if (ok) {
+		fs::rename(tmp, path, ec);
+	}
+	if (!ok || ec) {
+		fs::remove(tmp, ec);
+		return;
+	}
+
+	std::scoped_lock lock(mutex);
+	// Another thread may have stored the same blob in the meantime
+	if (blobs.emplace(name, blob_t{ size, ++clock }).second) {
+		total += size;
+	}
+}
+
+uint64_t blob_store_t::evict(uint64_t max_bytes)
+{
+	if (total <= max_bytes) {
+		return 0;
+	}
+	std::vector<std::pair<uint64_t, std::string>> lru;
+	for (const auto& [name, blob] : blobs) {
+		lru.emplace_back(blob.last_used, name);
+	}
+	std::sort(lru.begin(), lru.end());
+
+	uint64_t freed = 0;
+	for (size_t i = 0; i < lru.size() && total > max_bytes; i++) {
+		const std::string& name = lru[i].second;
+		uint64_t size = blobs[name].size;
+		std::error_code ec;
+		fs::remove(blob_path(name), ec);
+		blobs.erase(name);
+		total -= size;
+		freed += size;
+	}
+	if (freed) {
+		for (auto it = files.begin(); it != files.end();) {
+			it = blobs.count(sha256_hex(it->second)) ? std::next(it) : files.erase(it);
+		}
+	}
+	return freed;
+}
+
+uint64_t blob_store_t::gc(uint64_t max_bytes)
+{
+	std::scoped_lock lock(mutex);
+	uint64_t freed = evict(max_bytes);
+
+	// Leftovers from interrupted writes, from older versions, or from an
+	// index that got lost
+	std::error_code ec;
+	for (const fs::directory_entry& entry : fs::directory_iterator(dir, ec)) {
+		std::string name = entry.path().filename().string();
+		if (name == "index.txt" || blobs.count(name)) {
+			continue;
+		}
+		std::error_code size_ec;
+		uint64_t size = entry.file_size(size_ec);
+		if (fs::remove(entry.path(), size_ec)) {
+			freed += size;
+		}
+	}
+	return freed;
+}
+
+uint64_t blob_store_t::size() const
+{
+	std::scoped_lock lock(mutex);
+	return total;
+}
+
+size_t blob_store_t::count() const
+{
+	std::scoped_lock lock(mutex);
+	return blobs.size();
+}
+
+blob_store_t::stats_t blob_store_t::stats() const
+{
+	std::scoped_lock lock(mutex);
+	return counters;
+}
@@ -0,0 +1,90 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Content-addressed file store
+  */
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "sha256.h"
+
+#define BLOB_STORE_DIR "roulette/store"
+
+// Every file that was downloaded for a roll, stored once by content and
+// kept across rolls, so that rolling a patch again, or any other patch
+// that ships the same file, doesn't need the network. Blobs are
+// identified by their SHA-256. files.js only gives the CRC32, which can
+// collide, so files are looked up by their path inside the patch and
+// their CRC32, the same way roll_update() tells shared files apart. The
+// least recently used blobs are evicted once the store grows past its
+// cap. Safe to use from several threads at once.
+class blob_store_t
+{
+public:
+	struct stats_t
+	{
+		size_t hits = 0;
+		size_t misses = 0;
+	};
+
+	// The store only exists on disk once something has been put() into it.
+	blob_store_t(std::string dir, uint64_t max_bytes);
+	blob_store_t(const blob_store_t&) = delete;
+	blob_store_t& operator=(const blob_store_t&) = delete;
+
+	// Reads the index. Blobs whose file is missing are forgotten.
+	void load();
+	// Writes the index, after evicting blobs until the store fits its cap.
+	bool save();
+
+	// Fills [out] with the blob that was put() for [fn] with [crc32], from
+	// any patch, after checking it against its SHA-256. Counts as a hit or
+	// a miss.
+	bool get(const std::string& fn, uint32_t crc32, std::vector<uint8_t>& out);
+	// Stores [data] as the content of [fn] with [crc32], which it must
+	// have already been verified to have.
+	void put(const std::string& fn, uint32_t crc32, const void* data, size_t size);
+
+	// Evicts least recently used blobs until the store is at most
+	// [max_bytes] large, and deletes files that aren't in the index.
+	// Returns the number of bytes freed.
+	uint64_t gc(uint64_t max_bytes);
+
+	uint64_t size() const;
+	size_t count() const;
+	stats_t stats() const;
+
+private:
+	struct blob_t
+	{
+		uint64_t size;
+		// Higher is more recent. Taken from a counter that is saved with
+		// the index, so that the order survives across rolls.
+		uint64_t last_used;
+	};
+
+	std::string dir;
+	uint64_t max_bytes;
+	mutable std::mutex mutex;
+	// By the hex SHA-256, which is also the name of their file
+	std::unordered_map<std::string, blob_t> blobs;
+	// By (CRC32, path inside the patch), the blob each file was stored as
+	std::map<std::pair<uint32_t, std::string>, sha256_t> files;
+	uint64_t total = 0;
+	uint64_t clock = 0;
+	stats_t counters;
+
+	std::string blob_path(const std::string& name) const;
+	std::string index_path() const;
+	uint64_t evict(uint64_t max_bytes);
+};
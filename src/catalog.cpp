@@ -0,0 +1,229 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Hash-indexed repo/patch catalog
+  */
+
+#include "catalog.h"
+
+static uint32_t hash_str(std::string_view str)
+{
+	// FNV-1a
+	uint32_t hash = 0x811c9dc5;
+	for (char c : str) {
+		hash ^= (uint8_t)c;
+		hash *= 0x01000193;
+	}
+	// FNV-1a leaves the low bits badly mixed for IDs that only differ in
+	// their last characters, and the tables index by the low bits.
+	hash ^= hash >> 16;
+	hash *= 0x7feb352d;
+	hash ^= hash >> 15;
+	return hash;
+}
+
+static uint32_t hash_u64(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdull;
+	key ^= key >> 33;
+	return (uint32_t)key;
+}
+
+/// string_interner_t
+/// -----------------
+void string_interner_t::grow()
+{
+	size_t capacity = slots.empty() ? 64 : slots.size() * 2;
+	slots.assign(capacity, CATALOG_NONE);
+	size_t mask = capacity - 1;
+	for (uint32_t atom = 0; atom < hashes.size(); atom++) {
+		size_t i = hashes[atom] & mask;
+		while (slots[i] != CATALOG_NONE) {
+			i = (i + 1) & mask;
+		}
+		slots[i] = atom;
+	}
+}
+
+uint32_t string_interner_t::find(std::string_view str) const
+{
+	if (slots.empty()) {
+		return CATALOG_NONE;
+	}
+	uint32_t hash = hash_str(str);
+	size_t mask = slots.size() - 1;
+	for (size_t i = hash & mask; slots[i] != CATALOG_NONE; i = (i + 1) & mask) {
+		uint32_t atom = slots[i];
+		if (hashes[atom] == hash && this->str(atom) == str) {
+			return atom;
+		}
+	}
+	return CATALOG_NONE;
+}
+
+uint32_t string_interner_t::intern(std::string_view str)
+{
+	uint32_t atom = find(str);
+	if (atom != CATALOG_NONE) {
+		return atom;
+	}
+	// Load factor of at most 1/2
+	if ((hashes.size() + 1) * 2 > slots.size()) {
+		grow();
+	}
+	atom = (uint32_t)hashes.size();
+	uint32_t hash = hash_str(str);
+	hashes.push_back(hash);
+	chars.insert(chars.end(), str.begin(), str.end());
+	chars.push_back('\0');
+	offsets.push_back((uint32_t)chars.size());
+
+	size_t mask = slots.size() - 1;
+	size_t i = hash & mask;
+	while (slots[i] != CATALOG_NONE) {
+		i = (i + 1) & mask;
+	}
+	slots[i] = atom;
+	return atom;
+}
+
+std::string_view string_interner_t::str(uint32_t atom) const
+{
+	return std::string_view(chars.data() + offsets[atom], offsets[atom + 1] - offsets[atom] - 1);
+}
+
+/// pair_table_t
+/// ------------
+static const uint64_t PAIR_TABLE_EMPTY = UINT64_MAX;
+
+void pair_table_t::grow()
+{
+	std::vector<uint64_t> old_keys = std::move(keys);
+	std::vector<uint32_t> old_values = std::move(values);
+	size_t capacity = old_keys.empty() ? 64 : old_keys.size() * 2;
+	keys.assign(capacity, PAIR_TABLE_EMPTY);
+	values.assign(capacity, CATALOG_NONE);
+	size_t mask = capacity - 1;
+	for (size_t j = 0; j < old_keys.size(); j++) {
+		if (old_keys[j] != PAIR_TABLE_EMPTY) {
+			size_t i = hash_u64(old_keys[j]) & mask;
+			while (keys[i] != PAIR_TABLE_EMPTY) {
+				i = (i + 1) & mask;
+			}
+			keys[i] = old_keys[j];
+			values[i] = old_values[j];
+		}
+	}
+}
+
+void pair_table_t::insert(uint64_t key, uint32_t value)
+{
+	if ((count + 1) * 2 > keys.size()) {
+		grow();
+	}
+	size_t mask = keys.size() - 1;
+	size_t i = hash_u64(key) & mask;
+	while (keys[i] != PAIR_TABLE_EMPTY) {
+		if (keys[i] == key) {
+			return;
+		}
+		i = (i + 1) & mask;
+	}
+	keys[i] = key;
+	values[i] = value;
+	count++;
+}
+
+uint32_t pair_table_t::find(uint64_t key) const
+{
+	if (keys.empty()) {
+		return CATALOG_NONE;
+	}
+	size_t mask = keys.size() - 1;
+	for (size_t i = hash_u64(key) & mask; keys[i] != PAIR_TABLE_EMPTY; i = (i + 1) & mask) {
+		if (keys[i] == key) {
+			return values[i];
+		}
+	}
+	return CATALOG_NONE;
+}
+
+/// catalog_t
+/// ---------
+uint32_t catalog_t::add_repo(std::string_view repo_id)
+{
+	uint32_t repo = (uint32_t)repo_atoms.size();
+	uint32_t atom = atoms.intern(repo_id);
+	repo_atoms.push_back(atom);
+	patch_counts.push_back(0);
+	if (repo_by_atom.size() <= atom) {
+		repo_by_atom.resize(atoms.size(), CATALOG_NONE);
+	}
+	if (repo_by_atom[atom] == CATALOG_NONE) {
+		repo_by_atom[atom] = repo;
+	}
+	return repo;
+}
+
+void catalog_t::add_patch(uint32_t repo, std::string_view patch_id)
+{
+	uint32_t atom = atoms.intern(patch_id);
+	uint32_t pos = patch_counts[repo]++;
+	uint64_t key = (uint64_t)repo << 32 | atom;
+	if (repo_patches.find(key) == CATALOG_NONE) {
+		repo_patches.insert(key, pos);
+		pending_owners.emplace_back(atom, repo);
+	}
+}
+
+void catalog_t::finish()
+{
+	repo_by_atom.resize(atoms.size(), CATALOG_NONE);
+
+	// Counting sort by atom. Stable, so every owner list stays in the
+	// order the repos were added in.
+	owner_offsets.assign(atoms.size() + 1, 0);
+	for (const auto& [atom, repo] : pending_owners) {
+		owner_offsets[atom + 1]++;
+	}
+	for (size_t atom = 0; atom < atoms.size(); atom++) {
+		owner_offsets[atom + 1] += owner_offsets[atom];
+	}
+	owners.resize(pending_owners.size());
+	std::vector<uint32_t> fill(owner_offsets.begin(), owner_offsets.end() - 1);
+	for (const auto& [atom, repo] : pending_owners) {
+		owners[fill[atom]++] = repo;
+	}
+	pending_owners.clear();
+	pending_owners.shrink_to_fit();
+}
+
+uint32_t catalog_t::find_repo(std::string_view repo_id) const
+{
+	uint32_t atom = atoms.find(repo_id);
+	return atom < repo_by_atom.size() ? repo_by_atom[atom] : CATALOG_NONE;
+}
+
+uint32_t catalog_t::find_patch(uint32_t repo, std::string_view patch_id) const
+{
+	uint32_t atom = atoms.find(patch_id);
+	if (atom == CATALOG_NONE || repo == CATALOG_NONE) {
+		return CATALOG_NONE;
+	}
+	return repo_patches.find((uint64_t)repo << 32 | atom);
+}
+
+const uint32_t* catalog_t::patch_owners(std::string_view patch_id, size_t& count) const
+{
+	uint32_t atom = atoms.find(patch_id);
+	if (atom == CATALOG_NONE || atom + 1 >= owner_offsets.size()) {
+		count = 0;
+		return nullptr;
+	}
+	count = owner_offsets[atom + 1] - owner_offsets[atom];
+	return count ? &owners[owner_offsets[atom]] : nullptr;
+}
@@ -0,0 +1,99 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Hash-indexed repo/patch catalog
+  */
+
+#pragma once
+
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+#define CATALOG_NONE UINT32_MAX
+
+// Gives every distinct string a dense ID ("atom"), using an open-addressing
+// hash table with linear probing. All strings live in one buffer, each
+// followed by a \0.
+class string_interner_t
+{
+public:
+	uint32_t intern(std::string_view str);
+	// Returns CATALOG_NONE if [str] was never interned.
+	uint32_t find(std::string_view str) const;
+	std::string_view str(uint32_t atom) const;
+	// Only valid until the next intern()
+	const char* c_str(uint32_t atom) const { return chars.data() + offsets[atom]; }
+	size_t size() const { return hashes.size(); }
+
+private:
+	std::vector<char> chars;
+	// Start of every atom in [chars], plus the end of the last one
+	std::vector<uint32_t> offsets = { 0 };
+	std::vector<uint32_t> hashes;
+	// Atoms, or CATALOG_NONE for empty slots. Always a power of two.
+	std::vector<uint32_t> slots;
+
+	void grow();
+};
+
+// Open-addressing map from 64-bit keys to 32-bit values
+class pair_table_t
+{
+public:
+	// Keeps the existing value if [key] is already present
+	void insert(uint64_t key, uint32_t value);
+	// Returns CATALOG_NONE if [key] isn't present.
+	uint32_t find(uint64_t key) const;
+
+private:
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> values;
+	size_t count = 0;
+
+	void grow();
+};
+
+// Repos and their patches, indexed once after discovery so that looking up
+// a repo, or the repos that have a patch, is O(1) instead of a walk over
+// every repo. Repos and patches are identified by the order they were
+// added in, which matches their index in the discovered repo list.
+class catalog_t
+{
+public:
+	// Returns the index of the new repo.
+	uint32_t add_repo(std::string_view repo_id);
+	// [repo] is an index returned by add_repo().
+	void add_patch(uint32_t repo, std::string_view patch_id);
+	// Must be called after everything was added, before patch_owners().
+	void finish();
+
+	// If the same ID was added more than once, the first one wins.
+	uint32_t find_repo(std::string_view repo_id) const;
+	// Position of [patch_id] in the patch list of [repo]
+	uint32_t find_patch(uint32_t repo, std::string_view patch_id) const;
+	// Every repo that has [patch_id], in the order they were added.
+	// Returns nullptr if there is none.
+	const uint32_t* patch_owners(std::string_view patch_id, size_t& count) const;
+
+	size_t repo_count() const { return repo_atoms.size(); }
+	// Only valid until the next add_repo() or add_patch()
+	std::string_view repo_id(uint32_t repo) const { return atoms.str(repo_atoms[repo]); }
+
+private:
+	string_interner_t atoms;
+	std::vector<uint32_t> repo_atoms;
+	// Repo index by atom, CATALOG_NONE for atoms that aren't repo IDs
+	std::vector<uint32_t> repo_by_atom;
+	std::vector<uint32_t> patch_counts;
+	// ((repo << 32) | patch atom) -> position in that repo's patch list
+	pair_table_t repo_patches;
+	// (patch atom, repo) in the order they were added. Turned into
+	// [owner_offsets] and [owners] by finish().
+	std::vector<std::pair<uint32_t, uint32_t>> pending_owners;
+	std::vector<uint32_t> owner_offsets;
+	std::vector<uint32_t> owners;
+};
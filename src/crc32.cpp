@@ -0,0 +1,58 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * CRC32
+  */
+
+#include <string.h>
+#include "crc32.h"
+
+// Slicing-by-8: 8 bytes per step, using one table per byte position
+struct crc32_tables_t
+{
+	uint32_t t[8][256];
+
+	crc32_tables_t()
+	{
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++) {
+				c = (c >> 1) ^ (0xedb88320 & (0 - (c & 1)));
+			}
+			t[0][i] = c;
+		}
+		for (uint32_t i = 0; i < 256; i++) {
+			for (int k = 1; k < 8; k++) {
+				t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xff];
+			}
+		}
+	}
+};
+
+static const crc32_tables_t crc32_tables;
+
+uint32_t crc32_calc(const void* data, size_t size, uint32_t crc)
+{
+	const uint32_t (*t)[256] = crc32_tables.t;
+	const uint8_t* p = (const uint8_t*)data;
+	crc = ~crc;
+	while (size >= 8) {
+		uint32_t lo;
+		uint32_t hi;
+		memcpy(&lo, p, 4);
+		memcpy(&hi, p + 4, 4);
+		// Little endian, like every platform thcrap runs on
+		lo ^= crc;
+		crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24]
+			^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+		p += 8;
+		size -= 8;
+	}
+	while (size--) {
+		crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+	}
+	return ~crc;
+}
@@ -0,0 +1,17 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * CRC32
+  */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Same CRC32 as zlib's crc32(), which is what files.js contains.
+// Pass the previous result as [crc] to continue over several buffers.
+uint32_t crc32_calc(const void* data, size_t size, uint32_t crc = 0);
@@ -0,0 +1,145 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Memoized dependency resolution
+  */
+
+#include "dep_resolver.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+void dep_resolver_t::reserve(uint32_t node)
+{
+	if (node >= states.size()) {
+		states.resize(node + 1, NEW);
+		graph.resize(node + 1);
+	}
+}
+
+const std::vector<uint32_t>& dep_resolver_t::deps(uint32_t node)
+{
+	reserve(node);
+	if (states[node] == NEW && fetch) {
+		fetch(node);
+		states[node] = FETCHED;
+	}
+	if (states[node] < LOADED) {
+		states[node] = LOADED;
+		// [load] may hand out new node IDs, so the graph can grow while
+		// it runs. Don't hold on to references into it until it's done.
+		std::vector<uint32_t> node_deps;
+		load(node, node_deps);
+		graph[node] = std::move(node_deps);
+	}
+	return graph[node];
+}
+
+void dep_resolver_t::prefetch(const std::vector<uint32_t>& roots, unsigned jobs)
+{
+	std::vector<uint32_t> frontier;
+	std::vector<bool> queued;
+	auto enqueue = [&](uint32_t node) {
+		if (node != DEP_UNMET && state(node) == NEW) {
+			if (node >= queued.size()) {
+				queued.resize(node + 1);
+			}
+			if (!queued[node]) {
+				queued[node] = true;
+				frontier.push_back(node);
+			}
+		}
+	};
+	for (uint32_t root : roots) {
+		enqueue(root);
+	}
+
+	while (!frontier.empty()) {
+		std::vector<uint32_t> layer = std::move(frontier);
+		frontier.clear();
+		trace_span_t span("prefetch layer");
+		span.arg("patches", (int64_t)layer.size());
+		// Roots and nodes added by the last layer's [load] may not have a
+		// state yet
+		for (uint32_t node : layer) {
+			reserve(node);
+		}
+		if (fetch) {
+			parallel_for(layer.size(), jobs, [&](size_t i, unsigned) {
+				fetch(layer[i]);
+			});
+			for (uint32_t node : layer) {
+				states[node] = FETCHED;
+			}
+		}
+		for (uint32_t node : layer) {
+			for (uint32_t target : deps(node)) {
+				enqueue(target);
+			}
+		}
+	}
+}
+
+int dep_resolver_t::resolve(uint32_t root, const dep_visitor_t& visitor)
+{
+	struct frame_t
+	{
+		uint32_t node;
+		// Next dependency to look at
+		size_t index;
+	};
+
+	if (emitted(root)) {
+		return 0;
+	}
+	int errors = 0;
+	std::vector<frame_t> path;
+	deps(root);
+	states[root] = ACTIVE;
+	path.push_back({ root, 0 });
+
+	while (!path.empty()) {
+		uint32_t node = path.back().node;
+		size_t index = path.back().index++;
+		if (index == graph[node].size()) {
+			states[node] = DONE;
+			path.pop_back();
+			visitor.emit(node);
+			continue;
+		}
+
+		uint32_t target = graph[node][index];
+		if (visitor.satisfied(node, index)) {
+			continue;
+		}
+		if (target == DEP_UNMET) {
+			visitor.unmet(node, index);
+			errors++;
+			continue;
+		}
+		deps(target);
+		if (states[target] == ACTIVE) {
+			std::vector<uint32_t> cycle;
+			size_t start = path.size();
+			while (path[start - 1].node != target) {
+				start--;
+			}
+			for (size_t i = start - 1; i < path.size(); i++) {
+				cycle.push_back(path[i].node);
+			}
+			cycle.push_back(target);
+			visitor.cycle(cycle);
+			errors++;
+			continue;
+		}
+		if (states[target] == DONE) {
+			continue;
+		}
+		visitor.follow(node, index, target);
+		states[target] = ACTIVE;
+		path.push_back({ target, 0 });
+	}
+	return errors;
+}
@@ -0,0 +1,82 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Memoized dependency resolution
+  */
+
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+// Dependency that can't be satisfied by anything
+#define DEP_UNMET UINT32_MAX
+
+// Does the slow part of loading [node], like downloading it. Can run on
+// several threads at once, for different nodes, so it must only touch
+// state that belongs to [node].
+typedef std::function<void(uint32_t node)> dep_fetch_func_t;
+
+// Fills [deps] with the node every dependency of [node] resolves to, or
+// DEP_UNMET. Nodes are dense IDs handed out by the caller. Always called
+// from one thread at a time, after [node] was fetched.
+typedef std::function<void(uint32_t node, std::vector<uint32_t>& deps)> dep_load_func_t;
+
+// Hooks called while walking the graph. Dependencies are identified by
+// their node and their index in the list [load] returned for it.
+struct dep_visitor_t
+{
+	// Whether dependency [index] of [node] is already on the stack in some
+	// form, and can be skipped.
+	std::function<bool(uint32_t node, size_t index)> satisfied;
+	// Dependency [index] of [node] resolved to [target], which is about to
+	// be visited.
+	std::function<void(uint32_t node, size_t index, uint32_t target)> follow;
+	std::function<void(uint32_t node, size_t index)> unmet;
+	// [path] starts and ends with the same node.
+	std::function<void(const std::vector<uint32_t>& path)> cycle;
+	// Everything [node] depends on has been emitted.
+	std::function<void(uint32_t node)> emit;
+};
+
+// Walks dependency graphs depth-first with an explicit stack, so that
+// deep chains can't overflow the call stack and cycles are reported
+// instead of followed. Every node is loaded at most once per resolver,
+// and emitted at most once, after its dependencies, in the same order as
+// a recursive post-order walk.
+class dep_resolver_t
+{
+public:
+	explicit dep_resolver_t(dep_load_func_t load, dep_fetch_func_t fetch = nullptr)
+		: load(std::move(load)), fetch(std::move(fetch)) {}
+
+	// Fetches and loads [roots] and everything they depend on, one layer
+	// of the graph at a time, with up to [jobs] fetches running at once.
+	// Doesn't emit anything, so the order of resolve() stays the same.
+	void prefetch(const std::vector<uint32_t>& roots, unsigned jobs);
+
+	// Emits [root] and everything it depends on that wasn't emitted yet.
+	// Returns the number of unmet dependencies and cycles.
+	int resolve(uint32_t root, const dep_visitor_t& visitor);
+
+	// Memoized [load]
+	const std::vector<uint32_t>& deps(uint32_t node);
+	// Whether [node] was emitted by a previous resolve()
+	bool emitted(uint32_t node) const { return node < states.size() && states[node] == DONE; }
+
+private:
+	enum state_t : uint8_t { NEW, FETCHED, LOADED, ACTIVE, DONE };
+
+	dep_load_func_t load;
+	dep_fetch_func_t fetch;
+	std::vector<std::vector<uint32_t>> graph;
+	std::vector<state_t> states;
+
+	state_t state(uint32_t node) const { return node < states.size() ? states[node] : NEW; }
+	void reserve(uint32_t node);
+};
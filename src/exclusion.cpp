@@ -0,0 +1,172 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Repo and patch exclusion sets
+  */
+
+#include <algorithm>
+#include "exclusion.h"
+
+// Compares [seg] against [str] at [pos], with '?' matching anything
+static bool segment_at(std::string_view str, size_t pos, std::string_view seg)
+{
+	if (pos + seg.size() > str.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < seg.size(); i++) {
+		if (seg[i] != '?' && seg[i] != str[pos + i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+glob_t::glob_t(std::string_view pattern_in)
+	: pattern(pattern_in)
+{
+	size_t first_star = pattern.find('*');
+	has_star = first_star != std::string::npos;
+	if (!has_star) {
+		prefix = pattern;
+		return;
+	}
+	size_t last_star = pattern.rfind('*');
+	prefix = pattern.substr(0, first_star);
+	suffix = pattern.substr(last_star + 1);
+
+	size_t pos = first_star + 1;
+	while (pos < last_star) {
+		size_t star = pattern.find('*', pos);
+		if (star > pos) {
+			middle.push_back(pattern.substr(pos, star - pos));
+		}
+		pos = star + 1;
+	}
+}
+
+bool glob_t::is_pattern(std::string_view str)
+{
+	return str.find_first_of("*?") != std::string_view::npos;
+}
+
+bool glob_t::match(std::string_view str) const
+{
+	if (!has_star) {
+		return str.size() == prefix.size() && segment_at(str, 0, prefix);
+	}
+	if (str.size() < prefix.size() + suffix.size()) {
+		return false;
+	}
+	if (!segment_at(str, 0, prefix) || !segment_at(str, str.size() - suffix.size(), suffix)) {
+		return false;
+	}
+
+	// Taking the leftmost match of every middle segment never rules out
+	// a match that a later position would have found.
+	size_t pos = prefix.size();
+	size_t end = str.size() - suffix.size();
+	for (const std::string& seg : middle) {
+		for (;;) {
+			if (pos + seg.size() > end) {
+				return false;
+			}
+			if (segment_at(str, pos, seg)) {
+				break;
+			}
+			pos++;
+		}
+		pos += seg.size();
+	}
+	return true;
+}
+
+exclusion_set_t::exclusion_set_t(const exclusion_set_t& other)
+{
+	for (std::string_view entry : other.entries()) {
+		add(entry);
+	}
+}
+
+exclusion_set_t& exclusion_set_t::operator=(const exclusion_set_t& other)
+{
+	if (this != &other) {
+		*this = exclusion_set_t(other);
+	}
+	return *this;
+}
+
+std::string_view exclusion_set_t::store(std::string_view entry)
+{
+	return storage.emplace_back(entry);
+}
+
+void exclusion_set_t::compile_patterns()
+{
+	patterns.clear();
+	for (const auto& [pattern, order] : pattern_entries) {
+		patterns.emplace_back(pattern);
+	}
+}
+
+bool exclusion_set_t::toggle(std::string_view entry)
+{
+	auto& map = glob_t::is_pattern(entry) ? pattern_entries : exact;
+	auto it = map.find(entry);
+	if (it != map.end()) {
+		map.erase(it);
+		if (&map == &pattern_entries) {
+			compile_patterns();
+		}
+		return false;
+	}
+	add(entry);
+	return true;
+}
+
+void exclusion_set_t::add(std::string_view entry)
+{
+	auto& map = glob_t::is_pattern(entry) ? pattern_entries : exact;
+	if (map.find(entry) != map.end()) {
+		return;
+	}
+	map.emplace(store(entry), next_order++);
+	if (&map == &pattern_entries) {
+		patterns.emplace_back(entry);
+	}
+}
+
+bool exclusion_set_t::contains(std::string_view id) const
+{
+	if (exact.find(id) != exact.end()) {
+		return true;
+	}
+	for (const glob_t& glob : patterns) {
+		if (glob.match(id)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+std::vector<std::string_view> exclusion_set_t::entries() const
+{
+	std::vector<std::pair<uint64_t, std::string_view>> sorted;
+	sorted.reserve(exact.size() + pattern_entries.size());
+	for (const auto& [entry, order] : exact) {
+		sorted.emplace_back(order, entry);
+	}
+	for (const auto& [entry, order] : pattern_entries) {
+		sorted.emplace_back(order, entry);
+	}
+	std::sort(sorted.begin(), sorted.end());
+
+	std::vector<std::string_view> ret;
+	ret.reserve(sorted.size());
+	for (const auto& [order, entry] : sorted) {
+		ret.push_back(entry);
+	}
+	return ret;
+}
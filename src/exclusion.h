@@ -0,0 +1,73 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Repo and patch exclusion sets
+  */
+
+#pragma once
+
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// A glob pattern, split at its '*'s once so that matching doesn't have to
+// parse it again. '?' matches any single character.
+class glob_t
+{
+public:
+	explicit glob_t(std::string_view pattern);
+	bool match(std::string_view str) const;
+
+	static bool is_pattern(std::string_view str);
+
+private:
+	std::string pattern;
+	// Everything before the first '*'
+	std::string prefix;
+	// Everything after the last '*'
+	std::string suffix;
+	// Everything between two '*'s, in order
+	std::vector<std::string> middle;
+	bool has_star;
+};
+
+// IDs to leave out of the roulette. Plain IDs are looked up in a hash
+// table, and IDs containing '*' or '?' are compiled into glob patterns
+// when added, so checking an ID costs O(1) plus one match per pattern.
+class exclusion_set_t
+{
+public:
+	exclusion_set_t() = default;
+	// The hash tables point into [storage], so copies rebuild them
+	exclusion_set_t(const exclusion_set_t& other);
+	exclusion_set_t& operator=(const exclusion_set_t& other);
+	exclusion_set_t(exclusion_set_t&&) = default;
+	exclusion_set_t& operator=(exclusion_set_t&&) = default;
+
+	// Adds [entry] if it isn't in the set yet, and removes it otherwise.
+	// Returns true if it was added.
+	bool toggle(std::string_view entry);
+	void add(std::string_view entry);
+	bool contains(std::string_view id) const;
+
+	// Every entry, in the order it was added
+	std::vector<std::string_view> entries() const;
+
+private:
+	// Views into [storage], which never moves its strings. Each entry
+	// maps to the order it was added in.
+	std::unordered_map<std::string_view, uint64_t> exact;
+	std::unordered_map<std::string_view, uint64_t> pattern_entries;
+	std::vector<glob_t> patterns;
+	std::deque<std::string> storage;
+	uint64_t next_order = 0;
+
+	std::string_view store(std::string_view entry);
+	void compile_patterns();
+};
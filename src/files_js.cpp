@@ -0,0 +1,78 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Streaming files.js scanner
+  */
+
+#include <stdlib.h>
+#include "files_js.h"
+
+// Longer file names are passed on truncated. Game directories are at the
+// start of the name, so that doesn't matter for anything we look for.
+static const size_t FILES_JS_MAX_FN = 1024;
+
+files_js_scanner_t::files_js_scanner_t(file_func_t on_file)
+	: stream(FILES_JS_MAX_FN), on_file(std::move(on_file))
+{
+	on_token = [this](const json_token_t& token) {
+		if (token.depth == 0 && token.type != JSON_TOKEN_OBJECT_BEGIN && token.type != JSON_TOKEN_OBJECT_END) {
+			invalid = true;
+			return false;
+		}
+		if (token.depth == 1 && token.type == JSON_TOKEN_KEY) {
+			return this->on_file(token.text);
+		}
+		return true;
+	};
+}
+
+size_t files_js_scanner_t::feed(const void* data, size_t size)
+{
+	return stream.feed((const char*)data, size, on_token);
+}
+
+files_js_scanner_t::files_js_scanner_t(entry_func_t on_entry)
+	: stream(FILES_JS_MAX_FN), on_entry(std::move(on_entry))
+{
+	on_token = [this](const json_token_t& token) {
+		if (token.depth == 0 && token.type != JSON_TOKEN_OBJECT_BEGIN && token.type != JSON_TOKEN_OBJECT_END) {
+			invalid = true;
+			return false;
+		}
+		if (token.depth != 1) {
+			return true;
+		}
+		switch (token.type) {
+		case JSON_TOKEN_KEY:
+			pending_fn = token.text;
+			pending_truncated = token.truncated;
+			return true;
+		case JSON_TOKEN_NUMBER: {
+			// A truncated name would point to the wrong file
+			if (pending_truncated) {
+				return true;
+			}
+			std::string crc32(token.text);
+			return this->on_entry(pending_fn, (uint32_t)strtoull(crc32.c_str(), nullptr, 10));
+		}
+		case JSON_TOKEN_NULL:
+			if (pending_truncated) {
+				return true;
+			}
+			return this->on_entry(pending_fn, std::nullopt);
+		default:
+			return true;
+		}
+	};
+}
+
+bool files_js_scanner_t::finish()
+{
+	if (stopped()) {
+		return true;
+	}
+	return stream.finish(on_token) && !invalid;
+}
@@ -0,0 +1,54 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Streaming files.js scanner
+  */
+
+#pragma once
+
+#include <optional>
+#include "json_stream.h"
+
+// Reports the name of every file in a files.js document, as it is fed in
+// chunks straight from the download. Nothing is stored beyond the current
+// entry, so memory use doesn't depend on the size of files.js.
+class files_js_scanner_t
+{
+public:
+	// Return false to stop scanning, e.g. once the answer is known.
+	typedef std::function<bool(std::string_view fn)> file_func_t;
+	// Also gets the CRC32 of the file, or nothing if the file was deleted.
+	// Entries whose value is neither are skipped.
+	typedef std::function<bool(std::string_view fn, std::optional<uint32_t> crc32)> entry_func_t;
+
+	// Only reads the file names, so scanning can stop right after one
+	explicit files_js_scanner_t(file_func_t on_file);
+	explicit files_js_scanner_t(entry_func_t on_entry);
+	files_js_scanner_t(const files_js_scanner_t&) = delete;
+	files_js_scanner_t& operator=(const files_js_scanner_t&) = delete;
+
+	// Returns the number of bytes consumed, which is less than [size] if
+	// scanning has stopped or failed.
+	size_t feed(const void* data, size_t size);
+
+	// Call once the download has ended. Returns true if the whole
+	// document has been scanned, or if scanning was stopped early.
+	bool finish();
+
+	bool stopped() const { return stream.stopped() && !invalid; }
+	bool failed() const { return stream.failed() || invalid; }
+
+private:
+	json_stream_t stream;
+	file_func_t on_file;
+	entry_func_t on_entry;
+	json_token_func_t on_token;
+	// Key of the entry whose value comes next
+	std::string pending_fn;
+	bool pending_truncated = false;
+	// Set if the document isn't an object
+	bool invalid = false;
+};
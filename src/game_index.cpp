@@ -0,0 +1,154 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Persistent patch -> game index
+  */
+
+#include <optional>
+#include <string.h>
+#include "files_js.h"
+#include "game_index.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "transport.h"
+
+uint64_t fnv1a64(const void* data, size_t size, uint64_t hash)
+{
+	const uint8_t* p = (const uint8_t*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+std::string game_index_key(const char* repo_id, const char* patch_id)
+{
+	std::string key = repo_id;
+	key += '/';
+	key += patch_id;
+	return key;
+}
+
+uint64_t game_index_meta_hash(const char* title, const char* const* servers)
+{
+	if (!title) {
+		title = "";
+	}
+	// The terminators are hashed too, so that moving characters from
+	// one string to the next doesn't give the same hash.
+	uint64_t hash = fnv1a64(title, strlen(title) + 1);
+	for (size_t i = 0; servers && servers[i]; i++) {
+		hash = fnv1a64(servers[i], strlen(servers[i]) + 1, hash);
+	}
+	return hash;
+}
+
+bool game_index_entry_fresh(const game_index_entry_t& entry, uint64_t meta_hash, int64_t now, int64_t max_age)
+{
+	return entry.meta_hash == meta_hash && now - entry.checked < max_age && entry.checked <= now;
+}
+
+bool game_index_scan(const char* const* servers, const char* patch_id, const game_table_t& games, game_index_entry_t& entry)
+{
+	const game_set_t all_games = games.all();
+	for (size_t k = 0; servers && servers[k]; k++) {
+		std::string url = servers[k];
+		url += patch_id;
+		url += "/files.js";
+
+		game_set_t found;
+		uint64_t hash = FNV1A64_INIT;
+		files_js_scanner_t scanner([&](std::string_view fn) {
+			games.match(fn, found);
+			return found != all_games;
+		});
+
+		HttpStatus status = download_stream(url.c_str(), [&](const uint8_t* data, size_t size) {
+			size_t consumed = scanner.feed(data, size);
+			hash = fnv1a64(data, consumed, hash);
+			return consumed == size;
+		});
+		if ((status == HttpOk || scanner.stopped()) && scanner.finish()) {
+			// Only a hash of the whole file can be compared to later
+			// downloads
+			entry.files_js_hash = scanner.stopped() ? 0 : hash;
+			entry.games = found;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool game_index_observe(game_index_t& index, const std::string& key, uint64_t files_js_hash, const game_set_t& games, int64_t now)
+{
+	auto it = index.patches.find(key);
+	if (it == index.patches.end() || it->second.files_js_hash == files_js_hash) {
+		return false;
+	}
+	it->second.files_js_hash = files_js_hash;
+	it->second.games = games;
+	it->second.checked = now;
+	return true;
+}
+
+std::vector<size_t> game_index_stale(const game_index_t& index, const std::vector<game_index_source_t>& sources, int64_t now, int64_t max_age)
+{
+	std::vector<size_t> stale;
+	for (size_t i = 0; i < sources.size(); i++) {
+		const game_index_source_t& source = sources[i];
+		auto entry = index.patches.find(game_index_key(source.repo_id, source.patch_id));
+		if (entry == index.patches.end() || !game_index_entry_fresh(entry->second, game_index_meta_hash(source.title, source.servers), now, max_age)) {
+			stale.push_back(i);
+		}
+	}
+	return stale;
+}
+
+void game_index_update(game_index_t& index, const std::vector<game_index_source_t>& sources, const std::vector<size_t>& stale, int64_t now, unsigned jobs)
+{
+	trace_span_t span("game index update");
+	span.arg("patches", (int64_t)stale.size());
+
+	// Every patch gets its own slot, so that the index doesn't depend on
+	// which download finishes first.
+	std::vector<std::optional<game_index_entry_t>> refreshed(stale.size());
+	parallel_for(stale.size(), jobs, [&](size_t i, unsigned) {
+		const game_index_source_t& source = sources[stale[i]];
+		trace_span_t scan_span("files.js scan");
+		if (scan_span.recording()) {
+			scan_span.arg("patch", game_index_key(source.repo_id, source.patch_id));
+		}
+		game_index_entry_t entry;
+		if (!game_index_scan(source.servers, source.patch_id, index.games, entry)) {
+			return;
+		}
+		entry.meta_hash = game_index_meta_hash(source.title, source.servers);
+		entry.checked = now;
+		refreshed[i] = std::move(entry);
+	});
+
+	for (size_t i = 0; i < stale.size(); i++) {
+		if (refreshed[i]) {
+			const game_index_source_t& source = sources[stale[i]];
+			index.patches[game_index_key(source.repo_id, source.patch_id)] = std::move(*refreshed[i]);
+		}
+	}
+}
+
+void game_index_prune(game_index_t& index, const catalog_t& catalog)
+{
+	for (auto it = index.patches.begin(); it != index.patches.end();) {
+		std::string_view key = it->first;
+		size_t slash = key.find('/');
+		if (slash == std::string_view::npos || catalog.find_patch(catalog.find_repo(key.substr(0, slash)), key.substr(slash + 1)) == CATALOG_NONE) {
+			it = index.patches.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
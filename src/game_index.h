@@ -0,0 +1,96 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Persistent patch -> game index
+  */
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "catalog.h"
+#include "game_match.h"
+
+#define GAME_INDEX_FN "roulette/index.js"
+
+struct game_index_entry_t
+{
+	// Hash of the repo.js data this entry was built for (patch title and
+	// repo servers). If it changes, the patch has to be checked again.
+	uint64_t meta_hash = 0;
+	// FNV-1a of the whole files.js the games were read from, or 0 if the
+	// scan stopped before its end. Any other download of that files.js
+	// can tell from it whether the patch has changed.
+	uint64_t files_js_hash = 0;
+	// Unix time of the files.js download
+	int64_t checked = 0;
+	// Games touched by the patch, as bits of game_index_t::games
+	game_set_t games;
+};
+
+struct game_index_t
+{
+	game_table_t games;
+	// Games every entry was classified against. An entry can't tell
+	// whether a patch touches a game that isn't in this set.
+	game_set_t covered;
+	// Indexed by "<repo_id>/<patch_id>"
+	std::unordered_map<std::string, game_index_entry_t> patches;
+};
+
+#define FNV1A64_INIT 0xcbf29ce484222325ull
+
+uint64_t fnv1a64(const void* data, size_t size, uint64_t hash = FNV1A64_INIT);
+
+std::string game_index_key(const char* repo_id, const char* patch_id);
+// [servers] is NULL-terminated.
+uint64_t game_index_meta_hash(const char* title, const char* const* servers);
+
+// Returns true if [entry] can be used without downloading files.js again.
+bool game_index_entry_fresh(const game_index_entry_t& entry, uint64_t meta_hash, int64_t now, int64_t max_age);
+
+// What game_index_update() needs to know about a patch
+struct game_index_source_t
+{
+	const char* repo_id;
+	const char* patch_id;
+	// Can be nullptr
+	const char* title;
+	// NULL-terminated servers of the repo
+	const char* const* servers;
+};
+
+// Streams the files.js of [patch_id] from the first of [servers] that has
+// a valid one, and fills in [entry] with every game out of [games] that
+// at least one of its files belongs to. Stops downloading once all of
+// them have been found.
+bool game_index_scan(const char* const* servers, const char* patch_id, const game_table_t& games, game_index_entry_t& entry);
+
+// Updates the entry of [key] from a files.js of that patch that was
+// downloaded for something else, such as the update, if its FNV-1a
+// [files_js_hash] differs from the one the entry was built from. [games]
+// are the games its files belong to, out of every game in [index].
+// Patches without an entry are left alone. Returns true if the entry
+// changed.
+bool game_index_observe(game_index_t& index, const std::string& key, uint64_t files_js_hash, const game_set_t& games, int64_t now);
+
+// Positions of the [sources] whose entry in [index] is missing or stale
+std::vector<size_t> game_index_stale(const game_index_t& index, const std::vector<game_index_source_t>& sources, int64_t now, int64_t max_age);
+
+// Scans files.js again for the [sources] at the positions in [stale],
+// [jobs] at a time. Patches whose files.js can't be downloaded are left
+// out of the index, so that they are tried again next time.
+void game_index_update(game_index_t& index, const std::vector<game_index_source_t>& sources, const std::vector<size_t>& stale, int64_t now, unsigned jobs);
+
+// Forgets about patches that aren't in [catalog] anymore
+void game_index_prune(game_index_t& index, const catalog_t& catalog);
+
+// Defined in game_index_file.cpp, since they need jansson.
+// A missing or corrupted index file just results in an empty index.
+void game_index_load(game_index_t& index, const char* fn);
+bool game_index_save(const game_index_t& index, const char* fn);
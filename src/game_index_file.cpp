@@ -0,0 +1,145 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Persistent patch -> game index, reading and writing
+  */
+
+#include <thcrap.h>
+#include <vector>
+#include "game_index.h"
+
+// Bumped whenever the meaning of the stored data changes, which
+// invalidates every index written by older builds.
+static const json_int_t GAME_INDEX_VERSION = 2;
+
+// JSON can't reliably hold 64-bit integers, so hashes are stored as hex
+static json_t* hash_to_json(uint64_t hash)
+{
+	char buf[17];
+	snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)hash);
+	return json_string(buf);
+}
+
+static uint64_t hash_from_json(const json_t* json)
+{
+	const char* str = json_string_value(json);
+	return str ? strtoull(str, nullptr, 16) : 0;
+}
+
+// Most significant bit first, without leading zeroes
+static json_t* game_set_to_json(const game_set_t& set)
+{
+	std::string hex;
+	for (size_t nibble = GAME_SET_MAX / 4; nibble-- > 0;) {
+		unsigned val = 0;
+		for (size_t bit = 4; bit-- > 0;) {
+			val = (val << 1) | set[nibble * 4 + bit];
+		}
+		if (val || !hex.empty()) {
+			hex += "0123456789abcdef"[val];
+		}
+	}
+	return json_string(hex.c_str());
+}
+
+// [bits] maps the bits in the file to the ones in the current table
+static game_set_t game_set_from_json(const json_t* json, const std::vector<int>& bits)
+{
+	game_set_t set;
+	const char* hex = json_string_value(json);
+	if (!hex) {
+		return set;
+	}
+	size_t len = strlen(hex);
+	for (size_t nibble = 0; nibble < len; nibble++) {
+		char c = hex[len - 1 - nibble];
+		unsigned val = (c >= 'a') ? c - 'a' + 10 : (c >= 'A') ? c - 'A' + 10 : c - '0';
+		for (size_t bit = 0; bit < 4; bit++) {
+			size_t stored = nibble * 4 + bit;
+			if ((val >> bit) & 1 && stored < bits.size() && bits[stored] >= 0) {
+				set.set(bits[stored]);
+			}
+		}
+	}
+	return set;
+}
+
+void game_index_load(game_index_t& index, const char* fn)
+{
+	index.games = game_table_t();
+	index.covered.reset();
+	index.patches.clear();
+
+	json_t* index_js = json_load_file(fn, 0, nullptr);
+	if (!json_is_object(index_js)) {
+		json_decref(index_js);
+		return;
+	}
+	if (json_integer_value(json_object_get(index_js, "version")) != GAME_INDEX_VERSION) {
+		json_decref(index_js);
+		return;
+	}
+
+	// The file may have been written with a different game table
+	std::vector<int> bits;
+	size_t i;
+	json_t* val;
+	json_array_foreach(json_object_get(index_js, "games"), i, val) {
+		const char* game = json_string_value(val);
+		int bit = (game && *game) ? index.games.add(game) : -1;
+		bits.push_back(bit);
+		if (bit >= 0) {
+			index.covered.set(bit);
+		}
+	}
+
+	const char* key;
+	json_t* entry_js;
+	json_object_foreach(json_object_get(index_js, "patches"), key, entry_js) {
+		game_index_entry_t& entry = index.patches[key];
+		entry.meta_hash = hash_from_json(json_object_get(entry_js, "meta"));
+		entry.files_js_hash = hash_from_json(json_object_get(entry_js, "files_js"));
+		entry.checked = json_integer_value(json_object_get(entry_js, "checked"));
+		entry.games = game_set_from_json(json_object_get(entry_js, "games"), bits);
+	}
+	json_decref(index_js);
+}
+
+bool game_index_save(const game_index_t& index, const char* fn)
+{
+	// Only the games the entries actually cover, and of those, only the
+	// ones that thcrap knows or that some patch has files for
+	const game_table_t known;
+	game_set_t provided;
+	for (const auto& [key, entry] : index.patches) {
+		provided |= entry.games;
+	}
+	json_t* games_js = json_array();
+	for (size_t bit = 0; bit < index.games.size(); bit++) {
+		const std::string& game = index.games[bit];
+		bool keep = index.covered[bit] && (provided[bit] || known.find(game) >= 0);
+		json_array_append_new(games_js, json_string(keep ? game.c_str() : ""));
+	}
+
+	json_t* patches_js = json_object();
+	for (const auto& [key, entry] : index.patches) {
+		json_t* entry_js = json_object();
+		json_object_set_new(entry_js, "meta", hash_to_json(entry.meta_hash));
+		json_object_set_new(entry_js, "files_js", hash_to_json(entry.files_js_hash));
+		json_object_set_new(entry_js, "checked", json_integer(entry.checked));
+		json_object_set_new(entry_js, "games", game_set_to_json(entry.games));
+		json_object_set_new(patches_js, key.c_str(), entry_js);
+	}
+
+	json_t* index_js = json_object();
+	json_object_set_new(index_js, "version", json_integer(GAME_INDEX_VERSION));
+	json_object_set_new(index_js, "games", games_js);
+	json_object_set_new(index_js, "patches", patches_js);
+
+	int ret = json_dump_file(index_js, fn, JSON_COMPACT | JSON_SORT_KEYS);
+	json_decref(index_js);
+	return ret == 0;
+}
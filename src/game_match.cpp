@@ -0,0 +1,74 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Classifying patch files by game
+  */
+
+#include "game_match.h"
+
+static const char* const KNOWN_GAMES[] = {
+	"th01", "th02", "th03", "th04", "th05",
+	"th06", "th07", "th075", "th08", "th09", "th095",
+	"th10", "alcostg", "th105", "th11", "th12", "th123", "th125", "th128",
+	"th13", "th135", "th14", "th143", "th145", "th15", "th155",
+	"th16", "th165", "th17", "th175", "th18", "th185", "th19", "th20",
+	"megamari", "nsml",
+};
+
+game_table_t::game_table_t()
+{
+	for (const char* game : KNOWN_GAMES) {
+		add(game);
+	}
+}
+
+int game_table_t::add(std::string_view game)
+{
+	int bit = find(game);
+	if (bit >= 0) {
+		return bit;
+	}
+	if (ids.size() >= GAME_SET_MAX) {
+		return -1;
+	}
+	bit = (int)ids.size();
+	ids.emplace_back(game);
+	bits.emplace(ids.back(), bit);
+	return bit;
+}
+
+int game_table_t::find(std::string_view game) const
+{
+	auto it = bits.find(game);
+	return it != bits.end() ? it->second : -1;
+}
+
+void game_table_t::match(std::string_view fn, game_set_t& set) const
+{
+	std::string_view component = fn.substr(0, fn.find('/'));
+
+	// "th18/...", "th18"
+	int bit = find(component);
+	if (bit < 0) {
+		// "th18.js", "th18.v1.00a.js"
+		size_t dot = component.find('.');
+		if (dot != std::string_view::npos) {
+			bit = find(component.substr(0, dot));
+		}
+	}
+	if (bit >= 0) {
+		set.set(bit);
+	}
+}
+
+game_set_t game_table_t::all() const
+{
+	game_set_t set;
+	for (size_t bit = 0; bit < ids.size(); bit++) {
+		set.set(bit);
+	}
+	return set;
+}
@@ -0,0 +1,59 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Classifying patch files by game
+  */
+
+#pragma once
+
+#include <bitset>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#define GAME_SET_MAX 128
+
+// One bit per game in a game_table_t
+typedef std::bitset<GAME_SET_MAX> game_set_t;
+
+// Every game ID that patches are classified against, each with its own bit
+// in game_set_t.
+class game_table_t
+{
+public:
+	// Starts out with every game thcrap supports
+	game_table_t();
+	// [bits] points into [ids], which moving keeps valid but copying doesn't
+	game_table_t(const game_table_t&) = delete;
+	game_table_t& operator=(const game_table_t&) = delete;
+	game_table_t(game_table_t&&) = default;
+	game_table_t& operator=(game_table_t&&) = default;
+
+	// Returns the bit of [game], adding it if necessary, or -1 if the
+	// table is full.
+	int add(std::string_view game);
+	// Returns the bit of [game], or -1 if it isn't in the table.
+	int find(std::string_view game) const;
+
+	size_t size() const { return ids.size(); }
+	const std::string& operator[](size_t bit) const { return ids[bit]; }
+
+	// Adds the game that the patch file [fn] belongs to, if any, to [set].
+	// Only the first path component is looked at, the same way thcrap's
+	// own update filter does: "th12/..." and "th12.js" belong to th12,
+	// but "th128/..." doesn't. Safe to call from several threads, as
+	// long as nothing is being added.
+	void match(std::string_view fn, game_set_t& set) const;
+
+	// Bits of every game in the table
+	game_set_t all() const;
+
+private:
+	// deque, so that the views in [bits] never move
+	std::deque<std::string> ids;
+	std::unordered_map<std::string_view, int> bits;
+};
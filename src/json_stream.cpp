@@ -0,0 +1,366 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Incremental JSON tokenizer
+  */
+
+#include "json_stream.h"
+
+static bool is_ws(char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int hex_value(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+json_stream_t::json_stream_t(size_t max_string, unsigned max_depth)
+	: max_string(max_string), max_depth(max_depth)
+{
+}
+
+void json_stream_t::buf_append(char c)
+{
+	if (high_surrogate) {
+		// Unpaired surrogate
+		high_surrogate = 0;
+		buf_append_codepoint(0xFFFD);
+	}
+	if (buf.size() < max_string) {
+		buf += c;
+	}
+	else {
+		buf_truncated = true;
+	}
+}
+
+void json_stream_t::buf_append_codepoint(uint32_t cp)
+{
+	char utf8[4];
+	size_t len;
+	if (cp < 0x80) {
+		utf8[0] = (char)cp;
+		len = 1;
+	}
+	else if (cp < 0x800) {
+		utf8[0] = (char)(0xC0 | (cp >> 6));
+		utf8[1] = (char)(0x80 | (cp & 0x3F));
+		len = 2;
+	}
+	else if (cp < 0x10000) {
+		utf8[0] = (char)(0xE0 | (cp >> 12));
+		utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+		utf8[2] = (char)(0x80 | (cp & 0x3F));
+		len = 3;
+	}
+	else {
+		utf8[0] = (char)(0xF0 | (cp >> 18));
+		utf8[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+		utf8[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+		utf8[3] = (char)(0x80 | (cp & 0x3F));
+		len = 4;
+	}
+	// Never cut a code point in half at the limit
+	if (buf.size() + len <= max_string) {
+		buf.append(utf8, len);
+	}
+	else {
+		buf_truncated = true;
+	}
+}
+
+bool json_stream_t::emit(json_token_type_t type, const json_token_func_t& on_token, std::string_view text)
+{
+	json_token_t token;
+	token.type = type;
+	token.text = text;
+	token.truncated = buf_truncated && (type == JSON_TOKEN_KEY || type == JSON_TOKEN_STRING || type == JSON_TOKEN_NUMBER);
+	token.depth = (unsigned)stack.size();
+	if (!on_token(token)) {
+		state = STATE_STOPPED;
+		return false;
+	}
+	return true;
+}
+
+void json_stream_t::value_done()
+{
+	state = stack.empty() ? STATE_DONE : STATE_COMMA_OR_END;
+}
+
+bool json_stream_t::begin_value(char c, const json_token_func_t& on_token)
+{
+	switch (c) {
+	case '{':
+	case '[':
+		if (stack.size() >= max_depth) {
+			state = STATE_ERROR;
+			return false;
+		}
+		if (!emit(c == '{' ? JSON_TOKEN_OBJECT_BEGIN : JSON_TOKEN_ARRAY_BEGIN, on_token)) {
+			return false;
+		}
+		stack.push_back(c == '{');
+		state = c == '{' ? STATE_KEY_OR_END : STATE_VALUE_OR_END;
+		return true;
+	case '"':
+		buf.clear();
+		buf_truncated = false;
+		string_is_key = false;
+		state = STATE_STRING;
+		return true;
+	case 't':
+		literal = "true";
+		literal_type = JSON_TOKEN_TRUE;
+		break;
+	case 'f':
+		literal = "false";
+		literal_type = JSON_TOKEN_FALSE;
+		break;
+	case 'n':
+		literal = "null";
+		literal_type = JSON_TOKEN_NULL;
+		break;
+	default:
+		if (c == '-' || (c >= '0' && c <= '9')) {
+			buf.clear();
+			buf_truncated = false;
+			buf_append(c);
+			state = STATE_NUMBER;
+			return true;
+		}
+		state = STATE_ERROR;
+		return false;
+	}
+	literal_pos = 1;
+	state = STATE_LITERAL;
+	return true;
+}
+
+bool json_stream_t::finish_number(const json_token_func_t& on_token)
+{
+	char last = buf.back();
+	if (last == '-' || last == '+' || last == '.' || last == 'e' || last == 'E') {
+		state = STATE_ERROR;
+		return false;
+	}
+	if (!emit(JSON_TOKEN_NUMBER, on_token, buf)) {
+		return false;
+	}
+	value_done();
+	return true;
+}
+
+size_t json_stream_t::feed(const char* data, size_t size, const json_token_func_t& on_token)
+{
+	size_t i = 0;
+	while (i < size) {
+		char c = data[i];
+		switch (state) {
+		case STATE_STOPPED:
+		case STATE_ERROR:
+			return i;
+
+		case STATE_DONE:
+			if (!is_ws(c)) {
+				state = STATE_ERROR;
+				return i;
+			}
+			break;
+
+		case STATE_VALUE_OR_END:
+			if (c == ']') {
+				stack.pop_back();
+				if (!emit(JSON_TOKEN_ARRAY_END, on_token)) {
+					return i + 1;
+				}
+				value_done();
+				break;
+			}
+			[[fallthrough]];
+		case STATE_VALUE:
+			if (!is_ws(c) && !begin_value(c, on_token)) {
+				return state == STATE_STOPPED ? i + 1 : i;
+			}
+			break;
+
+		case STATE_KEY_OR_END:
+			if (c == '}') {
+				stack.pop_back();
+				if (!emit(JSON_TOKEN_OBJECT_END, on_token)) {
+					return i + 1;
+				}
+				value_done();
+				break;
+			}
+			[[fallthrough]];
+		case STATE_KEY:
+			if (c == '"') {
+				buf.clear();
+				buf_truncated = false;
+				string_is_key = true;
+				state = STATE_STRING;
+			}
+			else if (!is_ws(c)) {
+				state = STATE_ERROR;
+				return i;
+			}
+			break;
+
+		case STATE_COLON:
+			if (c == ':') {
+				state = STATE_VALUE;
+			}
+			else if (!is_ws(c)) {
+				state = STATE_ERROR;
+				return i;
+			}
+			break;
+
+		case STATE_COMMA_OR_END:
+			if (c == ',') {
+				state = stack.back() ? STATE_KEY : STATE_VALUE;
+			}
+			else if ((c == '}' && stack.back()) || (c == ']' && !stack.back())) {
+				stack.pop_back();
+				if (!emit(c == '}' ? JSON_TOKEN_OBJECT_END : JSON_TOKEN_ARRAY_END, on_token)) {
+					return i + 1;
+				}
+				value_done();
+			}
+			else if (!is_ws(c)) {
+				state = STATE_ERROR;
+				return i;
+			}
+			break;
+
+		case STATE_STRING:
+			if (c == '"') {
+				if (high_surrogate) {
+					high_surrogate = 0;
+					buf_append_codepoint(0xFFFD);
+				}
+				if (!emit(string_is_key ? JSON_TOKEN_KEY : JSON_TOKEN_STRING, on_token, buf)) {
+					return i + 1;
+				}
+				if (string_is_key) {
+					state = STATE_COLON;
+				}
+				else {
+					value_done();
+				}
+			}
+			else if (c == '\\') {
+				state = STATE_ESCAPE;
+			}
+			else if ((unsigned char)c < 0x20) {
+				state = STATE_ERROR;
+				return i;
+			}
+			else {
+				buf_append(c);
+			}
+			break;
+
+		case STATE_ESCAPE:
+			state = STATE_STRING;
+			switch (c) {
+			case '"':
+			case '\\':
+			case '/': buf_append(c); break;
+			case 'b': buf_append('\b'); break;
+			case 'f': buf_append('\f'); break;
+			case 'n': buf_append('\n'); break;
+			case 'r': buf_append('\r'); break;
+			case 't': buf_append('\t'); break;
+			case 'u':
+				unicode_digits = 0;
+				unicode_cp = 0;
+				state = STATE_UNICODE;
+				break;
+			default:
+				state = STATE_ERROR;
+				return i;
+			}
+			break;
+
+		case STATE_UNICODE: {
+			int digit = hex_value(c);
+			if (digit < 0) {
+				state = STATE_ERROR;
+				return i;
+			}
+			unicode_cp = (unicode_cp << 4) | digit;
+			if (++unicode_digits < 4) {
+				break;
+			}
+			state = STATE_STRING;
+			if (unicode_cp >= 0xD800 && unicode_cp <= 0xDBFF) {
+				if (high_surrogate) {
+					buf_append_codepoint(0xFFFD);
+				}
+				high_surrogate = unicode_cp;
+			}
+			else if (unicode_cp >= 0xDC00 && unicode_cp <= 0xDFFF) {
+				if (high_surrogate) {
+					buf_append_codepoint(0x10000 + ((high_surrogate - 0xD800) << 10) + (unicode_cp - 0xDC00));
+					high_surrogate = 0;
+				}
+				else {
+					buf_append_codepoint(0xFFFD);
+				}
+			}
+			else {
+				if (high_surrogate) {
+					high_surrogate = 0;
+					buf_append_codepoint(0xFFFD);
+				}
+				buf_append_codepoint(unicode_cp);
+			}
+			break;
+		}
+
+		case STATE_NUMBER:
+			if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+				buf_append(c);
+				break;
+			}
+			if (!finish_number(on_token)) {
+				return i;
+			}
+			// The character that ended the number still has to be read
+			continue;
+
+		case STATE_LITERAL:
+			if (c != literal[literal_pos]) {
+				state = STATE_ERROR;
+				return i;
+			}
+			if (literal[++literal_pos] == '\0') {
+				if (!emit(literal_type, on_token)) {
+					return i + 1;
+				}
+				value_done();
+			}
+			break;
+		}
+		i++;
+	}
+	return i;
+}
+
+bool json_stream_t::finish(const json_token_func_t& on_token)
+{
+	if (state == STATE_NUMBER && stack.empty()) {
+		finish_number(on_token);
+	}
+	return state == STATE_DONE;
+}
@@ -0,0 +1,108 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Incremental JSON tokenizer
+  */
+
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum json_token_type_t {
+	JSON_TOKEN_OBJECT_BEGIN,
+	JSON_TOKEN_OBJECT_END,
+	JSON_TOKEN_ARRAY_BEGIN,
+	JSON_TOKEN_ARRAY_END,
+	JSON_TOKEN_KEY,
+	JSON_TOKEN_STRING,
+	JSON_TOKEN_NUMBER,
+	JSON_TOKEN_TRUE,
+	JSON_TOKEN_FALSE,
+	JSON_TOKEN_NULL,
+};
+
+struct json_token_t
+{
+	json_token_type_t type;
+	// Unescaped text of keys and strings, and the literal text of numbers.
+	// Only valid during the callback.
+	std::string_view text;
+	// Set if [text] was cut off at the tokenizer's string limit
+	bool truncated;
+	// Nesting depth of the token. The top-level value is at depth 0, and
+	// the keys and values of a top-level object are at depth 1.
+	unsigned depth;
+};
+
+// Return false to stop tokenizing.
+typedef std::function<bool(const json_token_t& token)> json_token_func_t;
+
+// Push tokenizer: the document can be fed in chunks of any size as they
+// come off the network, and no value tree is ever built. Memory use is
+// bounded by [max_string] and [max_depth], regardless of document size.
+class json_stream_t
+{
+public:
+	json_stream_t(size_t max_string = 4096, unsigned max_depth = 64);
+
+	// Tokenizes [size] bytes of [data], calling [on_token] for every
+	// complete token. Returns the number of bytes consumed, which is less
+	// than [size] if [on_token] returned false or the input is invalid.
+	size_t feed(const char* data, size_t size, const json_token_func_t& on_token);
+
+	// Call once the input has ended. Returns true if it was a complete
+	// JSON document. A number at the very end is only emitted here.
+	bool finish(const json_token_func_t& on_token);
+
+	bool stopped() const { return state == STATE_STOPPED; }
+	bool failed() const { return state == STATE_ERROR; }
+	bool done() const { return state == STATE_DONE; }
+
+private:
+	enum state_t {
+		STATE_VALUE,        // Expecting a value
+		STATE_VALUE_OR_END, // Right after '[', expecting a value or ']'
+		STATE_KEY,          // Expecting a key
+		STATE_KEY_OR_END,   // Right after '{', expecting a key or '}'
+		STATE_COLON,
+		STATE_COMMA_OR_END, // After a value inside a container
+		STATE_STRING,
+		STATE_ESCAPE,
+		STATE_UNICODE,
+		STATE_NUMBER,
+		STATE_LITERAL,
+		STATE_DONE,         // Top-level value complete
+		STATE_STOPPED,
+		STATE_ERROR,
+	};
+
+	state_t state = STATE_VALUE;
+	// Containers currently open; true for objects
+	std::vector<bool> stack;
+	size_t max_string;
+	unsigned max_depth;
+
+	std::string buf;
+	bool buf_truncated = false;
+	bool string_is_key = false;
+	unsigned unicode_digits = 0;
+	uint32_t unicode_cp = 0;
+	uint32_t high_surrogate = 0;
+	const char* literal = nullptr;
+	size_t literal_pos = 0;
+	json_token_type_t literal_type = JSON_TOKEN_NULL;
+
+	void buf_append(char c);
+	void buf_append_codepoint(uint32_t cp);
+	bool emit(json_token_type_t type, const json_token_func_t& on_token, std::string_view text = {});
+	void value_done();
+	bool begin_value(char c, const json_token_func_t& on_token);
+	bool finish_number(const json_token_func_t& on_token);
+};
@@ -0,0 +1,138 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Resolving the dependencies of rolled patches
+  */
+
+#include "game_index.h"
+#include "json_stream.h"
+#include "patch_graph.h"
+#include "roll.h"
+#include "trace.h"
+#include "transport.h"
+
+bool patch_js_dependencies(const void* data, size_t size, std::vector<patch_dependency_t>& deps)
+{
+	json_stream_t stream;
+	bool in_deps = false;
+	json_token_func_t on_token = [&](const json_token_t& token) {
+		if (token.depth == 1 && token.type == JSON_TOKEN_KEY) {
+			in_deps = token.text == "dependencies";
+		}
+		else if (in_deps && token.depth == 2 && token.type == JSON_TOKEN_STRING && !token.text.empty()) {
+			size_t slash = token.text.find('/');
+			if (slash == std::string_view::npos) {
+				deps.push_back({ "", std::string(token.text) });
+			}
+			else {
+				deps.push_back({ std::string(token.text.substr(0, slash)), std::string(token.text.substr(slash + 1)) });
+			}
+		}
+		return true;
+	};
+	stream.feed((const char*)data, size, on_token);
+	return stream.finish(on_token);
+}
+
+patch_graph_t::patch_graph_t(const catalog_t& catalog, repo_servers_func_t servers, arena_t& arena)
+	: catalog(catalog), servers(std::move(servers)), arena(arena),
+	resolver(
+		[this](uint32_t node, std::vector<uint32_t>& deps) { load(node, deps); },
+		[this](uint32_t node) { fetch(node); }
+	)
+{
+}
+
+uint32_t patch_graph_t::node(std::string_view repo_id, std::string_view patch_id)
+{
+	const char* repo = arena.intern(repo_id);
+	const char* patch = arena.intern(patch_id);
+	auto [it, inserted] = ids.try_emplace({ repo, patch }, (uint32_t)nodes.size());
+	if (inserted) {
+		nodes.push_back({ repo, patch });
+	}
+	return it->second;
+}
+
+const std::vector<uint8_t>* patch_graph_t::patch_js(uint32_t node) const
+{
+	return nodes[node].has_patch_js ? &nodes[node].patch_js : nullptr;
+}
+
+// Runs on several threads at once, while no nodes are added
+void patch_graph_t::fetch(uint32_t node)
+{
+	node_t& n = nodes[node];
+	trace_span_t span("bootstrap");
+	if (span.recording()) {
+		span.arg("patch", game_index_key(n.repo_id, n.patch_id));
+	}
+	uint32_t repo = catalog.find_repo(n.repo_id);
+	const char* const* repo_servers = repo != CATALOG_NONE ? servers(repo) : nullptr;
+	for (size_t k = 0; repo_servers && repo_servers[k]; k++) {
+		std::string url = repo_servers[k];
+		url += n.patch_id;
+		url += "/patch.js";
+		if (download_to_memory(url.c_str(), n.patch_js) == HttpOk) {
+			n.has_patch_js = true;
+			patch_js_dependencies(n.patch_js.data(), n.patch_js.size(), n.dependencies);
+			return;
+		}
+	}
+	n.patch_js.clear();
+}
+
+void patch_graph_t::load(uint32_t from, std::vector<uint32_t>& deps)
+{
+	// node() can add to [nodes], but deque elements stay where they are
+	const node_t& n = nodes[from];
+	for (const patch_dependency_t& dep : n.dependencies) {
+		const char* dep_repo_id = dep.repo_id.empty() ? nullptr : dep.repo_id.c_str();
+		uint32_t target_repo = roll_find_dependency(catalog, n.repo_id, dep_repo_id, dep.patch_id.c_str());
+		if (target_repo == CATALOG_NONE) {
+			deps.push_back(DEP_UNMET);
+		}
+		else {
+			deps.push_back(node(catalog.repo_id(target_repo), dep.patch_id));
+		}
+	}
+}
+
+int patch_graph_t::add(uint32_t root, sel_stack_t& stack, const patch_graph_visitor_t& visitor)
+{
+	trace_span_t span("add patch");
+	if (span.recording()) {
+		span.arg("patch", game_index_key(repo_id(root), patch_id(root)));
+	}
+	dep_visitor_t dep_visitor;
+	dep_visitor.satisfied = [&](uint32_t node, size_t index) {
+		const patch_dependency_t& dep = nodes[node].dependencies[index];
+		return stack.contains(dep.repo_id.empty() ? nullptr : dep.repo_id.c_str(), dep.patch_id.c_str());
+	};
+	dep_visitor.follow = [](uint32_t, size_t, uint32_t) {};
+	dep_visitor.unmet = [&](uint32_t node, size_t index) {
+		if (visitor.unmet) {
+			visitor.unmet(node, nodes[node].dependencies[index]);
+		}
+	};
+	dep_visitor.cycle = [&](const std::vector<uint32_t>& path) {
+		if (visitor.cycle) {
+			visitor.cycle(path);
+		}
+	};
+	dep_visitor.emit = [&](uint32_t node) {
+		stack.push(repo_id(node), patch_id(node));
+		if (visitor.emit) {
+			visitor.emit(node);
+		}
+	};
+	return resolver.resolve(root, dep_visitor);
+}
+
+void patch_graph_t::prefetch(const std::vector<uint32_t>& roots, unsigned jobs)
+{
+	resolver.prefetch(roots, jobs);
+}
@@ -0,0 +1,115 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Resolving the dependencies of rolled patches
+  */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "arena.h"
+#include "catalog.h"
+#include "dep_resolver.h"
+#include "sel_stack.h"
+
+// One entry of the "dependencies" of a patch.js
+struct patch_dependency_t
+{
+	// Empty if the dependency doesn't name a repo
+	std::string repo_id;
+	std::string patch_id;
+};
+
+// Appends the "dependencies" of the patch.js in [data] to [deps]. Entries
+// are "<repo>/<patch>" or just "<patch>", the same as for patch_init().
+// Returns false if [data] isn't valid JSON.
+bool patch_js_dependencies(const void* data, size_t size, std::vector<patch_dependency_t>& deps);
+
+// NULL-terminated server list of the repo with the index [repo] in the
+// catalog
+typedef std::function<const char* const*(uint32_t repo)> repo_servers_func_t;
+
+struct interned_pair_hash_t
+{
+	size_t operator()(const std::pair<const char*, const char*>& key) const
+	{
+		return std::hash<const void*>()(key.first) * 31 + std::hash<const void*>()(key.second);
+	}
+};
+
+// Hooks called by patch_graph_t::add()
+struct patch_graph_visitor_t
+{
+	std::function<void(uint32_t node, const patch_dependency_t& dep)> unmet;
+	// [path] starts and ends with the same node.
+	std::function<void(const std::vector<uint32_t>& path)> cycle;
+	// [node] was just pushed onto the stack, after everything it depends on
+	std::function<void(uint32_t node)> emit;
+};
+
+// Every patch that add() has come across during a roll, by (repo ID,
+// patch ID). The patch.js of each one is downloaded once through the
+// current transport, and its dependencies are resolved once, the same way
+// thcrap_configure does it.
+class patch_graph_t
+{
+public:
+	// IDs are interned in [arena], which must outlive the graph.
+	patch_graph_t(const catalog_t& catalog, repo_servers_func_t servers, arena_t& arena);
+	patch_graph_t(const patch_graph_t&) = delete;
+	patch_graph_t& operator=(const patch_graph_t&) = delete;
+
+	uint32_t node(std::string_view repo_id, std::string_view patch_id);
+
+	// Downloads the patch.js of [roots] and of everything they depend on,
+	// one layer of the graph at a time, [jobs] at once.
+	void prefetch(const std::vector<uint32_t>& roots, unsigned jobs);
+
+	// Pushes [root] and everything it depends on onto [stack], dependencies
+	// first, skipping whatever [stack] already has. Returns the number of
+	// unmet dependencies and cycles.
+	int add(uint32_t root, sel_stack_t& stack, const patch_graph_visitor_t& visitor);
+
+	size_t size() const { return nodes.size(); }
+	const char* repo_id(uint32_t node) const { return nodes[node].repo_id; }
+	const char* patch_id(uint32_t node) const { return nodes[node].patch_id; }
+	// As downloaded, or nullptr if no server of its repo had one
+	const std::vector<uint8_t>* patch_js(uint32_t node) const;
+	const std::vector<patch_dependency_t>& dependencies(uint32_t node) const { return nodes[node].dependencies; }
+	// The node each of dependencies() resolved to, or DEP_UNMET
+	const std::vector<uint32_t>& targets(uint32_t node) { return resolver.deps(node); }
+
+private:
+	struct node_t
+	{
+		// Interned in [arena]
+		const char* repo_id;
+		const char* patch_id;
+		bool has_patch_js = false;
+		std::vector<uint8_t> patch_js;
+		std::vector<patch_dependency_t> dependencies;
+	};
+
+	const catalog_t& catalog;
+	repo_servers_func_t servers;
+	arena_t& arena;
+	// deque, so that adding nodes while loading one doesn't move it.
+	// Downloads write to their own node only, while no nodes are added.
+	std::deque<node_t> nodes;
+	// By interned (repo ID, patch ID), so comparing pointers is enough
+	std::unordered_map<std::pair<const char*, const char*>, uint32_t, interned_pair_hash_t> ids;
+	dep_resolver_t resolver;
+
+	void fetch(uint32_t node);
+	void load(uint32_t from, std::vector<uint32_t>& deps);
+};
@@ -0,0 +1,140 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Lock-free progress reporting
+  */
+
+#include "progress.h"
+
+/// progress_ring_t
+/// ---------------
+progress_ring_t::progress_ring_t(size_t capacity)
+{
+	size_t size = 1;
+	while (size < capacity) {
+		size *= 2;
+	}
+	slots.resize(size);
+	mask = size - 1;
+}
+
+bool progress_ring_t::push(const progress_event_t& event)
+{
+	size_t t = tail.load(std::memory_order_relaxed);
+	if (t - head.load(std::memory_order_acquire) == slots.size()) {
+		return false;
+	}
+	slots[t & mask] = event;
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+bool progress_ring_t::pop(progress_event_t& event)
+{
+	size_t h = head.load(std::memory_order_relaxed);
+	if (h == tail.load(std::memory_order_acquire)) {
+		return false;
+	}
+	event = slots[h & mask];
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+/// progress_reporter_t
+/// -------------------
+progress_reporter_t::progress_reporter_t(unsigned producers, sink_func_t sink, std::chrono::steady_clock::duration interval, size_t ring_capacity)
+	: sink(std::move(sink)), interval(interval)
+{
+	for (unsigned i = 0; i < producers; i++) {
+		rings.push_back(std::make_unique<progress_ring_t>(ring_capacity));
+	}
+	thread = std::thread([this] {
+		while (running.load(std::memory_order_acquire)) {
+			// Nothing to wake up on without a lock, so an idle reporter
+			// polls. Progress lines don't need to be any faster than this.
+			if (drain() == 0 && waiting.load(std::memory_order_relaxed) == 0) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+			}
+		}
+		// Whatever was pushed before stop()
+		drain();
+	});
+}
+
+progress_reporter_t::~progress_reporter_t()
+{
+	stop();
+}
+
+void progress_reporter_t::push(unsigned producer, const progress_event_t& event)
+{
+	progress_ring_t& ring = *rings[producer];
+	if (event.in_progress) {
+		if (!ring.push(event)) {
+			dropped_count++;
+		}
+		return;
+	}
+	if (ring.push(event)) {
+		return;
+	}
+	// Backs off to sleeping, so that a spinning producer can't keep the
+	// reporter from running when there are fewer cores than threads
+	waiting++;
+	for (unsigned spins = 0; !ring.push(event); spins++) {
+		if (spins < 4) {
+			std::this_thread::yield();
+		}
+		else {
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+		}
+	}
+	waiting--;
+}
+
+void progress_reporter_t::stop()
+{
+	if (thread.joinable()) {
+		running.store(false, std::memory_order_release);
+		thread.join();
+	}
+}
+
+size_t progress_reporter_t::drain()
+{
+	size_t count = 0;
+	progress_event_t event;
+	for (const auto& ring : rings) {
+		while (ring->pop(event)) {
+			deliver(event);
+			count++;
+		}
+	}
+	return count;
+}
+
+void progress_reporter_t::deliver(const progress_event_t& event)
+{
+	uint64_t key = (uint64_t)event.group << 32 | event.file;
+	if (!event.in_progress) {
+		files.erase(key);
+		sink(event);
+		return;
+	}
+
+	// The same file can be downloaded from another source after the
+	// first one failed, which starts over.
+	auto now = std::chrono::steady_clock::now();
+	auto [it, inserted] = files.try_emplace(key, file_state_t{ event.source, now });
+	if (inserted || it->second.source != event.source) {
+		it->second = { event.source, now };
+		return;
+	}
+	if (now - it->second.last >= interval) {
+		it->second.last = now;
+		sink(event);
+	}
+}
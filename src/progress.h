@@ -0,0 +1,123 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Lock-free progress reporting
+  */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// No source, e.g. for a file that was written from a local copy
+#define PROGRESS_NO_SOURCE UINT32_MAX
+
+// What happened to one file. Fixed-size and without anything to free, so
+// that pushing one never allocates. Files are identified by numbers that
+// only the caller knows the meaning of.
+struct progress_event_t
+{
+	// e.g. a patch, and a file of that patch
+	uint32_t group;
+	uint32_t file;
+	// e.g. the server the file is downloaded from, or PROGRESS_NO_SOURCE
+	uint32_t source;
+	// Passed through as is
+	int status;
+	// Set for the events sent while a file is still arriving, which are
+	// throttled and can be dropped. Every other event ends the file.
+	bool in_progress;
+	// Must be a string literal, or otherwise outlive the reporter
+	const char* error;
+	uint64_t file_progress;
+	uint64_t file_size;
+	// Files done so far, out of how many
+	uint64_t processed;
+	uint64_t total;
+};
+
+// Single-producer, single-consumer queue of events, without locks
+class progress_ring_t
+{
+public:
+	// [capacity] is rounded up to a power of two.
+	explicit progress_ring_t(size_t capacity);
+	progress_ring_t(const progress_ring_t&) = delete;
+	progress_ring_t& operator=(const progress_ring_t&) = delete;
+
+	// Only called by the producer. Returns false if the ring is full.
+	bool push(const progress_event_t& event);
+	// Only called by the consumer. Returns false if the ring is empty.
+	bool pop(progress_event_t& event);
+
+private:
+	std::vector<progress_event_t> slots;
+	size_t mask;
+	// On separate cache lines, so that the producer and the consumer
+	// don't keep taking the line from each other
+	alignas(64) std::atomic<size_t> head = 0;
+	alignas(64) std::atomic<size_t> tail = 0;
+};
+
+// Collects the events of a fixed number of producer threads, each with its
+// own ring, and hands them to [sink] on a thread of its own. Producers
+// never wait for the sink, or for each other. Per file, in-progress
+// events are only passed on once every [interval], starting one
+// [interval] after the first one, and the throttling state of a file is
+// dropped once it ends. Events of one producer reach the sink in the
+// order they were pushed.
+class progress_reporter_t
+{
+public:
+	typedef std::function<void(const progress_event_t& event)> sink_func_t;
+
+	progress_reporter_t(unsigned producers, sink_func_t sink, std::chrono::steady_clock::duration interval, size_t ring_capacity = 1024);
+	progress_reporter_t(const progress_reporter_t&) = delete;
+	progress_reporter_t& operator=(const progress_reporter_t&) = delete;
+	// Calls stop()
+	~progress_reporter_t();
+
+	// Must only be called from one thread per [producer], which must be
+	// less than the number given to the constructor. If the ring is full,
+	// in-progress events are dropped, and every other event waits for
+	// the reporter to make room.
+	void push(unsigned producer, const progress_event_t& event);
+
+	// Passes on everything that was pushed so far, and ends the thread.
+	void stop();
+
+	// In-progress events that were dropped because a ring was full
+	size_t dropped() const { return dropped_count; }
+
+private:
+	struct file_state_t
+	{
+		uint32_t source;
+		std::chrono::steady_clock::time_point last;
+	};
+
+	std::vector<std::unique_ptr<progress_ring_t>> rings;
+	sink_func_t sink;
+	std::chrono::steady_clock::duration interval;
+	std::atomic<bool> running = true;
+	std::atomic<size_t> dropped_count = 0;
+	// Producers waiting for room, which keep the reporter from sleeping
+	std::atomic<unsigned> waiting = 0;
+	std::thread thread;
+
+	// Only used by the reporter thread
+	std::unordered_map<uint64_t, file_state_t> files;
+
+	// Returns the number of events taken from the rings.
+	size_t drain();
+	void deliver(const progress_event_t& event);
+};
@@ -0,0 +1,111 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Repo discovery over the current transport
+  */
+
+#include <optional>
+#include <unordered_set>
+#include "json_stream.h"
+#include "repo_crawl.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "transport.h"
+
+bool repo_info_parse(const void* data, size_t size, repo_info_t& repo)
+{
+	repo = {};
+	std::string key;
+	bool is_object = false;
+
+	json_stream_t stream;
+	json_token_func_t on_token = [&](const json_token_t& token) {
+		if (token.depth == 0) {
+			is_object = token.type == JSON_TOKEN_OBJECT_BEGIN || token.type == JSON_TOKEN_OBJECT_END;
+			return is_object;
+		}
+		if (token.depth == 1) {
+			if (token.type == JSON_TOKEN_KEY) {
+				key = token.text;
+			}
+			else if (token.type == JSON_TOKEN_STRING) {
+				if (key == "id") repo.id = token.text;
+				else if (key == "title") repo.title = token.text;
+				else if (key == "contact") repo.contact = token.text;
+			}
+			return true;
+		}
+		if (token.depth != 2) {
+			return true;
+		}
+		if (token.type == JSON_TOKEN_STRING && key == "servers") {
+			repo.servers.emplace_back(token.text);
+		}
+		else if (token.type == JSON_TOKEN_STRING && key == "neighbors") {
+			repo.neighbors.emplace_back(token.text);
+		}
+		else if (token.type == JSON_TOKEN_KEY && key == "patches") {
+			repo.patches.push_back({ std::string(token.text), {} });
+		}
+		else if (token.type == JSON_TOKEN_STRING && key == "patches" && !repo.patches.empty()) {
+			repo.patches.back().title = token.text;
+		}
+		return true;
+	};
+	stream.feed((const char*)data, size, on_token);
+	return stream.finish(on_token) && is_object && !repo.id.empty();
+}
+
+static std::string repo_url(const std::string& url)
+{
+	std::string ret = url;
+	if (ret.empty() || ret.back() != '/') {
+		ret += '/';
+	}
+	return ret;
+}
+
+std::vector<repo_info_t> repo_crawl(const char* start_url, unsigned jobs)
+{
+	std::vector<repo_info_t> repos;
+	std::unordered_set<std::string> seen_urls;
+	std::unordered_set<std::string> seen_ids;
+
+	std::vector<std::string> layer = { repo_url(start_url) };
+	seen_urls.insert(layer[0]);
+	while (!layer.empty()) {
+		// Every repo of a layer is downloaded at once, then they are
+		// linked in order, so that the result doesn't depend on which
+		// download finishes first.
+		trace_span_t span("crawl layer");
+		span.arg("repos", (int64_t)layer.size());
+		std::vector<std::optional<repo_info_t>> fetched(layer.size());
+		parallel_for(layer.size(), jobs, [&](size_t i, unsigned) {
+			std::vector<uint8_t> repo_js;
+			std::string url = layer[i] + "repo.js";
+			repo_info_t repo;
+			if (download_to_memory(url.c_str(), repo_js) == HttpOk && repo_info_parse(repo_js.data(), repo_js.size(), repo)) {
+				fetched[i] = std::move(repo);
+			}
+		});
+
+		std::vector<std::string> next;
+		for (std::optional<repo_info_t>& repo : fetched) {
+			if (!repo || !seen_ids.insert(repo->id).second) {
+				continue;
+			}
+			for (const std::string& neighbor : repo->neighbors) {
+				std::string url = repo_url(neighbor);
+				if (seen_urls.insert(url).second) {
+					next.push_back(std::move(url));
+				}
+			}
+			repos.push_back(std::move(*repo));
+		}
+		layer = std::move(next);
+	}
+	return repos;
+}
@@ -0,0 +1,43 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Repo discovery over the current transport
+  */
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+struct repo_patch_info_t
+{
+	std::string id;
+	// Empty if repo.js doesn't have one
+	std::string title;
+};
+
+// Everything roulette reads from a repo.js. Empty strings stand for
+// missing values.
+struct repo_info_t
+{
+	std::string id;
+	std::string title;
+	std::string contact;
+	std::vector<std::string> servers;
+	std::vector<std::string> neighbors;
+	// In the order of repo.js, which seeded rolls depend on
+	std::vector<repo_patch_info_t> patches;
+};
+
+// Returns false if [data] isn't a repo.js with an ID.
+bool repo_info_parse(const void* data, size_t size, repo_info_t& repo);
+
+// Downloads the repo.js of [start_url] and of every repo reachable
+// through its neighbors with download_to_memory(), [jobs] at a time.
+// Repos are returned in breadth-first order; if several have the same ID,
+// the first one wins. Empty if no repo could be downloaded.
+std::vector<repo_info_t> repo_crawl(const char* start_url, unsigned jobs);
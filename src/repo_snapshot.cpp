@@ -0,0 +1,206 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Local snapshot of the discovered repo network
+  */
+
+#include <thcrap.h>
+#include <ctime>
+#include <string>
+#include "repo_snapshot.h"
+
+static const json_int_t REPO_SNAPSHOT_VERSION = 1;
+
+static json_t* strings_to_json(char** strs)
+{
+	json_t* ret = json_array();
+	for (size_t i = 0; strs && strs[i]; i++) {
+		json_array_append_new(ret, json_string(strs[i]));
+	}
+	return ret;
+}
+
+static char* strdup_or_null(const char* str)
+{
+	return str ? strdup(str) : nullptr;
+}
+
+static char** strings_from_json(const json_t* arr)
+{
+	size_t count = json_array_size(arr);
+	char** ret = (char**)malloc((count + 1) * sizeof(char*));
+	size_t n = 0;
+	size_t i;
+	json_t* val;
+	json_array_foreach(arr, i, val) {
+		if (const char* str = json_string_value(val)) {
+			ret[n++] = strdup(str);
+		}
+	}
+	ret[n] = nullptr;
+	return ret;
+}
+
+bool repo_snapshot_save(const char* fn, const char* start_url, repo_t** repos)
+{
+	json_t* repos_js = json_array();
+	for (size_t i = 0; repos[i]; i++) {
+		const repo_t* repo = repos[i];
+		// An array rather than an object, so that the order of the patches
+		// (and with it, seeded rolls) survives the round trip.
+		json_t* patches_js = json_array();
+		for (size_t j = 0; repo->patches && repo->patches[j].patch_id; j++) {
+			json_array_append_new(patches_js, json_pack("{s:s, s:s?}",
+				"id", repo->patches[j].patch_id,
+				"title", repo->patches[j].title
+			));
+		}
+		json_array_append_new(repos_js, json_pack("{s:s, s:s?, s:s?, s:o, s:o, s:o}",
+			"id", repo->id,
+			"title", repo->title,
+			"contact", repo->contact,
+			"servers", strings_to_json(repo->servers),
+			"neighbors", strings_to_json(repo->neighbors),
+			"patches", patches_js
+		));
+	}
+
+	json_t* snapshot = json_pack("{s:I, s:I, s:s, s:o}",
+		"version", REPO_SNAPSHOT_VERSION,
+		"time", (json_int_t)time(nullptr),
+		"start_url", start_url,
+		"repos", repos_js
+	);
+
+	std::string tmp_fn = fn;
+	tmp_fn += ".tmp";
+	int ret = json_dump_file(snapshot, tmp_fn.c_str(), JSON_COMPACT);
+	json_decref(snapshot);
+	if (ret != 0) {
+		return false;
+	}
+	return MoveFileExU(tmp_fn.c_str(), fn, MOVEFILE_REPLACE_EXISTING);
+}
+
+repo_t** repo_snapshot_load(const char* fn, const char* start_url, int64_t* age)
+{
+	json_t* snapshot = json_load_file(fn, 0, nullptr);
+	const char* snapshot_url = json_string_value(json_object_get(snapshot, "start_url"));
+	json_t* repos_js = json_object_get(snapshot, "repos");
+	if (
+		json_integer_value(json_object_get(snapshot, "version")) != REPO_SNAPSHOT_VERSION
+		|| !snapshot_url || strcmp(snapshot_url, start_url) != 0
+		|| !json_is_array(repos_js)
+	) {
+		json_decref(snapshot);
+		return nullptr;
+	}
+	*age = (int64_t)time(nullptr) - json_integer_value(json_object_get(snapshot, "time"));
+
+	repo_t** repos = (repo_t**)malloc((json_array_size(repos_js) + 1) * sizeof(repo_t*));
+	size_t n = 0;
+	size_t i;
+	json_t* repo_js;
+	json_array_foreach(repos_js, i, repo_js) {
+		const char* id = json_string_value(json_object_get(repo_js, "id"));
+		if (!id) {
+			continue;
+		}
+		repo_t* repo = (repo_t*)calloc(1, sizeof(repo_t));
+		repo->id = strdup(id);
+		repo->title = strdup_or_null(json_string_value(json_object_get(repo_js, "title")));
+		repo->contact = strdup_or_null(json_string_value(json_object_get(repo_js, "contact")));
+		repo->servers = strings_from_json(json_object_get(repo_js, "servers"));
+		repo->neighbors = strings_from_json(json_object_get(repo_js, "neighbors"));
+
+		json_t* patches_js = json_object_get(repo_js, "patches");
+		repo->patches = (repo_patch_t*)calloc(json_array_size(patches_js) + 1, sizeof(repo_patch_t));
+		size_t patch_count = 0;
+		size_t j;
+		json_t* patch_js;
+		json_array_foreach(patches_js, j, patch_js) {
+			const char* patch_id = json_string_value(json_object_get(patch_js, "id"));
+			if (patch_id) {
+				repo->patches[patch_count].patch_id = strdup(patch_id);
+				repo->patches[patch_count].title = strdup_or_null(json_string_value(json_object_get(patch_js, "title")));
+				patch_count++;
+			}
+		}
+		repos[n++] = repo;
+	}
+	repos[n] = nullptr;
+	json_decref(snapshot);
+	return repos;
+}
+
+static char* strdup_or_null(const std::string& str)
+{
+	return str.empty() ? nullptr : strdup(str.c_str());
+}
+
+static char** strings_from_vector(const std::vector<std::string>& strs)
+{
+	char** ret = (char**)malloc((strs.size() + 1) * sizeof(char*));
+	for (size_t i = 0; i < strs.size(); i++) {
+		ret[i] = strdup(strs[i].c_str());
+	}
+	ret[strs.size()] = nullptr;
+	return ret;
+}
+
+repo_t** repo_snapshot_from_crawl(const std::vector<repo_info_t>& repos)
+{
+	if (repos.empty()) {
+		return nullptr;
+	}
+	repo_t** ret = (repo_t**)malloc((repos.size() + 1) * sizeof(repo_t*));
+	for (size_t i = 0; i < repos.size(); i++) {
+		const repo_info_t& info = repos[i];
+		repo_t* repo = (repo_t*)calloc(1, sizeof(repo_t));
+		repo->id = strdup(info.id.c_str());
+		repo->title = strdup_or_null(info.title);
+		repo->contact = strdup_or_null(info.contact);
+		repo->servers = strings_from_vector(info.servers);
+		repo->neighbors = strings_from_vector(info.neighbors);
+		repo->patches = (repo_patch_t*)calloc(info.patches.size() + 1, sizeof(repo_patch_t));
+		for (size_t j = 0; j < info.patches.size(); j++) {
+			repo->patches[j].patch_id = strdup(info.patches[j].id.c_str());
+			repo->patches[j].title = strdup_or_null(info.patches[j].title);
+		}
+		ret[i] = repo;
+	}
+	ret[repos.size()] = nullptr;
+	return ret;
+}
+
+static void repo_snapshot_free_repo(repo_t* repo)
+{
+	free(repo->id);
+	free(repo->title);
+	free(repo->contact);
+	for (size_t j = 0; repo->servers[j]; j++) {
+		free(repo->servers[j]);
+	}
+	free(repo->servers);
+	for (size_t j = 0; repo->neighbors[j]; j++) {
+		free(repo->neighbors[j]);
+	}
+	free(repo->neighbors);
+	for (size_t j = 0; repo->patches[j].patch_id; j++) {
+		free(repo->patches[j].patch_id);
+		free(repo->patches[j].title);
+	}
+	free(repo->patches);
+	free(repo);
+}
+
+void repo_snapshot_free(repo_t** repos)
+{
+	for (size_t i = 0; repos && repos[i]; i++) {
+		repo_snapshot_free_repo(repos[i]);
+	}
+	free(repos);
+}
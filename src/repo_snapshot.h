@@ -0,0 +1,35 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Local snapshot of the discovered repo network
+  */
+
+#pragma once
+
+#include <thcrap.h>
+#include <stdint.h>
+#include <vector>
+#include "repo_crawl.h"
+
+#define REPO_SNAPSHOT_FN "roulette/repos.js"
+
+// Writes [repos], as discovered from [start_url], together with the
+// current time. The old snapshot is only replaced once the new one has
+// been fully written.
+bool repo_snapshot_save(const char* fn, const char* start_url, repo_t** repos);
+
+// Returns a NULL-terminated repo list in the same layout as
+// RepoDiscover_wrapper(), or NULL if [fn] doesn't hold a snapshot of
+// [start_url]. [age] receives the number of seconds since it was written.
+repo_t** repo_snapshot_load(const char* fn, const char* start_url, int64_t* age);
+
+// Same as repo_snapshot_load(), but from the result of repo_crawl().
+// Returns NULL if [repos] is empty.
+repo_t** repo_snapshot_from_crawl(const std::vector<repo_info_t>& repos);
+
+// Frees a list returned by repo_snapshot_load() or
+// repo_snapshot_from_crawl().
+void repo_snapshot_free(repo_t** repos);
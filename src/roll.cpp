@@ -0,0 +1,159 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Choosing the patches of a roll
+  */
+
+#include <algorithm>
+#include <stdio.h>
+#include "roll.h"
+
+template <typename Pred>
+static void keep_if(std::vector<roll_candidate_t>& candidates, Pred pred)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i < candidates.size(); i++) {
+		if (pred(candidates[i])) {
+			candidates[kept++] = candidates[i];
+		}
+	}
+	candidates.resize(kept);
+}
+
+void roll_exclude(std::vector<roll_candidate_t>& candidates, const exclusion_set_t& repo_exclude, const exclusion_set_t& patch_exclude)
+{
+	keep_if(candidates, [&](const roll_candidate_t& c) {
+		return !repo_exclude.contains(c.repo_id) && !patch_exclude.contains(c.patch_id);
+	});
+}
+
+void roll_filter_game(std::vector<roll_candidate_t>& candidates, const game_index_t& index, int game_bit)
+{
+	if (game_bit < 0 || game_bit >= GAME_SET_MAX) {
+		return;
+	}
+	keep_if(candidates, [&](const roll_candidate_t& c) {
+		auto entry = index.patches.find(game_index_key(c.repo_id, c.patch_id));
+		return entry != index.patches.end() && entry->second.games[game_bit];
+	});
+}
+
+double roll_weight(const roll_weights_t& weights, const char* repo_id, const char* patch_id)
+{
+	double weight = 1.0;
+	auto repo_it = weights.repos.find(repo_id);
+	if (repo_it != weights.repos.end()) {
+		weight *= repo_it->second;
+	}
+	auto patch_it = weights.patches.find(game_index_key(repo_id, patch_id));
+	if (patch_it == weights.patches.end()) {
+		patch_it = weights.patches.find(patch_id);
+	}
+	if (patch_it != weights.patches.end()) {
+		weight *= patch_it->second;
+	}
+	return weight;
+}
+
+std::vector<double> roll_apply_weights(std::vector<roll_candidate_t>& candidates, const roll_weights_t& weights)
+{
+	std::vector<double> ret;
+	if (weights.empty()) {
+		return ret;
+	}
+	keep_if(candidates, [&](const roll_candidate_t& c) {
+		double weight = roll_weight(weights, c.repo_id, c.patch_id);
+		if (weight > 0.0) {
+			ret.push_back(weight);
+		}
+		return weight > 0.0;
+	});
+	return ret;
+}
+
+void roll_pick(std::vector<roll_candidate_t>& candidates, std::vector<double> weights, size_t count, rng_t& rng)
+{
+	if (weights.empty()) {
+		sample_to_front(candidates, count, rng);
+	}
+	else {
+		weighted_sampler_t sampler(std::move(weights));
+		std::vector<roll_candidate_t> picks;
+		for (size_t i = 0; i < count; i++) {
+			size_t idx = sampler.draw(rng);
+			picks.push_back(candidates[idx]);
+			sampler.remove(idx);
+		}
+		std::copy(picks.begin(), picks.end(), candidates.begin());
+	}
+	candidates.resize(count);
+}
+
+uint32_t roll_find_dependency(const catalog_t& catalog, const char* orig_repo_id, const char* dep_repo_id, const char* dep_patch_id)
+{
+	// Absolute dependency
+	// In fact, just a check to see whether the patch is available.
+	if (dep_repo_id) {
+		uint32_t remote_repo = catalog.find_repo(dep_repo_id);
+		return catalog.find_patch(remote_repo, dep_patch_id) != CATALOG_NONE ? remote_repo : CATALOG_NONE;
+	}
+
+	// Relative dependency
+	uint32_t orig_repo = catalog.find_repo(orig_repo_id);
+	if (catalog.find_patch(orig_repo, dep_patch_id) != CATALOG_NONE) {
+		return orig_repo;
+	}
+
+	// Owners are in list order, so this is the same repo that walking the
+	// list would find.
+	size_t owner_count;
+	const uint32_t* owners = catalog.patch_owners(dep_patch_id, owner_count);
+	return owners ? owners[0] : CATALOG_NONE;
+}
+
+// Same escaping as jansson without any flags
+static void append_json_string(std::string& out, const char* str)
+{
+	out += '"';
+	for (const char* p = str; *p; p++) {
+		switch (*p) {
+		case '"': out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\b': out += "\\b"; break;
+		case '\f': out += "\\f"; break;
+		case '\n': out += "\\n"; break;
+		case '\r': out += "\\r"; break;
+		case '\t': out += "\\t"; break;
+		default:
+			if ((uint8_t)*p < 0x20) {
+				char buf[8];
+				snprintf(buf, sizeof(buf), "\\u%04X", (uint8_t)*p);
+				out += buf;
+			}
+			else {
+				out += *p;
+			}
+		}
+	}
+	out += '"';
+}
+
+std::string roll_runconfig_json(const sel_stack_t& stack, const char* game, const runconfig_patch_func_t& patch_entry)
+{
+	std::string ret = "{\n  \"console\": false,\n  \"dat_dump\": false,\n";
+	if (game && *game) {
+		ret += "  \"game\": ";
+		append_json_string(ret, game);
+		ret += ",\n";
+	}
+	ret += "  \"patches\": [";
+	for (size_t i = 0; i < stack.size(); i++) {
+		ret += i ? ",\n    " : "\n    ";
+		ret += patch_entry(stack.repo_id(i), stack.patch_id(i));
+	}
+	ret += stack.size() ? "\n  ]\n}" : "]\n}";
+	return ret;
+}
@@ -0,0 +1,82 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Choosing the patches of a roll
+  */
+
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "catalog.h"
+#include "exclusion.h"
+#include "game_index.h"
+#include "sampler.h"
+#include "sel_stack.h"
+
+// A patch that can be rolled. The IDs point into the repo list, which
+// must outlive it.
+struct roll_candidate_t
+{
+	// Index of the repo in the repo list and the catalog
+	uint32_t repo;
+	const char* repo_id;
+	const char* patch_id;
+};
+
+// Relative chances of being rolled. Anything not listed has a weight of 1.
+struct roll_weights_t
+{
+	// By repo ID
+	std::unordered_map<std::string, double> repos;
+	// By "<repo_id>/<patch_id>", or just the patch ID for every repo
+	std::unordered_map<std::string, double> patches;
+
+	bool empty() const { return repos.empty() && patches.empty(); }
+};
+
+// All of these filter [candidates] in place, which keeps the order of the
+// repo list that seeded rolls depend on.
+
+void roll_exclude(std::vector<roll_candidate_t>& candidates, const exclusion_set_t& repo_exclude, const exclusion_set_t& patch_exclude);
+
+// Keeps the candidates that [index] knows to touch the game [game_bit].
+// Candidates that aren't indexed are dropped. Without a valid
+// [game_bit], like the -1 of a game that isn't in the table, every
+// candidate is kept.
+void roll_filter_game(std::vector<roll_candidate_t>& candidates, const game_index_t& index, int game_bit);
+
+double roll_weight(const roll_weights_t& weights, const char* repo_id, const char* patch_id);
+
+// Drops the candidates with a weight of 0, which can't be rolled and
+// don't count towards the maximum. Returns the weight of every remaining
+// candidate, or nothing if [weights] is empty.
+std::vector<double> roll_apply_weights(std::vector<roll_candidate_t>& candidates, const roll_weights_t& weights);
+
+// Draws [count] different candidates, with a chance proportional to
+// [weights], or uniformly if that is empty, and keeps only those, in the
+// order they were drawn. [count] must not be larger than the number of
+// candidates.
+void roll_pick(std::vector<roll_candidate_t>& candidates, std::vector<double> weights, size_t count, rng_t& rng);
+
+// Repo that the dependency [dep_repo_id]/[dep_patch_id] of a patch from
+// [orig_repo_id] resolves to, the same way thcrap_configure does it:
+// - with a repo, only that repo
+// - without one, the repo of the patch itself, then the first repo that
+//   has the patch
+// [dep_repo_id] can be nullptr. Returns CATALOG_NONE if nothing has it.
+uint32_t roll_find_dependency(const catalog_t& catalog, const char* orig_repo_id, const char* dep_repo_id, const char* dep_patch_id);
+
+// One entry of "patches" in the run configuration, as JSON on a single
+// line. The front end gets it from patch_to_runconfig_json().
+typedef std::function<std::string(const char* repo_id, const char* patch_id)> runconfig_patch_func_t;
+
+// Run configuration for [stack], with every patch in stack order as
+// [patch_entry] gives it, and with sorted keys. [game] can be empty.
+std::string roll_runconfig_json(const sel_stack_t& stack, const char* game, const runconfig_patch_func_t& patch_entry);
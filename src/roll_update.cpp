@@ -0,0 +1,527 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Downloading the files of a rolled patch stack
+  */
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+#include "crc32.h"
+#include "files_js.h"
+#include "game_index.h"
+#include "progress.h"
+#include "roll_update.h"
+#include "scheduler.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "transport.h"
+
+// Patch archives are UTF-8, which only u8path() takes as such on Windows
+namespace fs = std::filesystem;
+
+// What the chosen game needs, and everything else
+enum roll_priority_t {
+	PRIORITY_LAUNCH = 0,
+	PRIORITY_FILL = 1,
+};
+
+struct roll_file_t
+{
+	std::string fn;
+	// Nothing if the file was deleted
+	std::optional<uint32_t> crc32;
+};
+
+struct roll_patch_t
+{
+	roll_update_patch_t* patch = nullptr;
+	std::vector<roll_file_t> files;
+	// Whether each file of [files] is up to date on disk. One byte per
+	// file, so that every job writes to its own.
+	std::vector<uint8_t> current;
+};
+
+// Reported with the local path as the URL, e.g. if the file couldn't be
+// written
+static const uint32_t ROLL_SOURCE_LOCAL = PROGRESS_NO_SOURCE - 1;
+
+// Download threads only push events into their own ring of [reporter].
+// The progress callback runs on the reporter's thread, so downloads never
+// wait for it, and it never runs twice at once.
+struct roll_progress_t
+{
+	const roll_update_t& update;
+	const std::vector<roll_patch_t>& patches;
+	size_t total = 0;
+	std::atomic<size_t> processed = 0;
+	std::atomic<bool> cancelled = false;
+	// Only if there is a callback
+	std::optional<progress_reporter_t> reporter;
+
+	roll_progress_t(const roll_update_t& update, const std::vector<roll_patch_t>& patches, size_t total)
+		: update(update), patches(patches), total(total)
+	{
+		if (update.progress_callback) {
+			reporter.emplace(update.jobs ? update.jobs : 1, [this](const progress_event_t& event) {
+				deliver(event);
+			}, update.progress_interval);
+		}
+	}
+
+	// [worker] is the scheduler worker that is calling, and [source] the
+	// server of [p] the file is coming from.
+	void report(unsigned worker, const roll_patch_t& p, size_t i, uint32_t source, roll_file_status_t status, const char* error, size_t file_progress, size_t file_size)
+	{
+		if (!reporter) {
+			return;
+		}
+		progress_event_t event = {};
+		event.group = (uint32_t)(&p - patches.data());
+		event.file = (uint32_t)i;
+		event.source = source;
+		event.status = status;
+		event.in_progress = status == ROLL_FILE_DOWNLOADING;
+		event.error = error;
+		event.file_progress = file_progress;
+		event.file_size = file_size;
+		event.processed = processed;
+		event.total = total;
+		reporter->push(worker, event);
+	}
+
+	void deliver(const progress_event_t& event)
+	{
+		const roll_patch_t& p = patches[event.group];
+		const std::string& fn = p.files[event.file].fn;
+		std::string url;
+		if (event.source == ROLL_SOURCE_LOCAL) {
+			url = p.patch->archive + fn;
+		}
+		else if (event.source != PROGRESS_NO_SOURCE) {
+			url = p.patch->servers[event.source] + fn;
+		}
+		roll_progress_status_t s = {};
+		s.patch = p.patch;
+		s.fn = fn.c_str();
+		s.url = event.source != PROGRESS_NO_SOURCE ? url.c_str() : nullptr;
+		s.status = (roll_file_status_t)event.status;
+		s.error = event.error;
+		s.file_progress = event.file_progress;
+		s.file_size = event.file_size;
+		s.nb_files_downloaded = event.processed;
+		s.nb_files_total = event.total;
+		if (!update.progress_callback(s)) {
+			cancelled = true;
+		}
+	}
+};
+
+// Reads every entry of files.js from the first server that has a valid one
+static bool fetch_files_js(roll_patch_t& p)
+{
+	trace_span_t span("files.js");
+	span.arg("patch", p.patch->id);
+	for (const std::string& server : p.patch->servers) {
+		std::string url = server + "files.js";
+
+		std::vector<roll_file_t> files;
+		uint64_t hash = FNV1A64_INIT;
+		files_js_scanner_t scanner([&](std::string_view fn, std::optional<uint32_t> crc32) {
+			files.push_back({ std::string(fn), crc32 });
+			return true;
+		});
+		HttpStatus status = download_stream(url.c_str(), [&](const uint8_t* data, size_t size) {
+			hash = fnv1a64(data, size, hash);
+			return scanner.feed(data, size) == size;
+		});
+		if (status == HttpOk && scanner.finish()) {
+			p.patch->files_js_hash = hash;
+			p.files = std::move(files);
+			p.current.assign(p.files.size(), 0);
+			return true;
+		}
+	}
+	return false;
+}
+
+static roll_file_status_t file_status_from_http(HttpStatus status)
+{
+	switch (status) {
+	case HttpOk:
+		return ROLL_FILE_OK;
+	case HttpCancelled:
+		return ROLL_FILE_CANCELLED;
+	case HttpClientError:
+		return ROLL_FILE_CLIENT_ERROR;
+	case HttpServerError:
+		return ROLL_FILE_SERVER_ERROR;
+	default:
+		return ROLL_FILE_SYSTEM_ERROR;
+	}
+}
+
+static const char* http_status_error(HttpStatus status)
+{
+	switch (status) {
+	case HttpClientError:
+		return "file not found or not accessible";
+	case HttpServerError:
+		return "server error";
+	default:
+		return "download failed";
+	}
+}
+
+// Every file of the stack with the same path inside its patch and the
+// same CRC32. files.js only has the CRC32, which can collide, so files
+// with different paths are never taken for the same one, even if their
+// CRC32 is the same. The same path with the same CRC32 is what thcrap's
+// own updater trusts to be the same file, too.
+struct roll_blob_t
+{
+	uint32_t crc32;
+	roll_priority_t priority = PRIORITY_FILL;
+	// (patch, index in its files)
+	std::vector<std::pair<roll_patch_t*, size_t>> members;
+};
+
+struct roll_counters_t
+{
+	std::atomic<size_t> downloaded = 0;
+	std::atomic<size_t> downloaded_bytes = 0;
+	std::atomic<size_t> deduplicated = 0;
+	std::atomic<size_t> saved_bytes = 0;
+	std::atomic<size_t> restored = 0;
+	std::atomic<size_t> restored_bytes = 0;
+	std::atomic<size_t> failed = 0;
+	std::atomic<size_t> failed_launch = 0;
+};
+
+static std::string roll_path(const roll_patch_t& p, size_t i)
+{
+	return p.patch->archive + p.files[i].fn;
+}
+
+// Downloads the file [i] of [p] from the first of its servers that has it
+// with the right CRC32.
+static bool download_file(roll_patch_t& p, size_t i, unsigned worker, roll_progress_t& progress, std::vector<uint8_t>& data)
+{
+	const roll_file_t& file = p.files[i];
+	for (size_t k = 0; k < p.patch->servers.size() && !progress.cancelled; k++) {
+		std::string url = p.patch->servers[k] + file.fn;
+
+		data.clear();
+		HttpStatus status = download_stream(url.c_str(), [&](const uint8_t* chunk, size_t size) {
+			data.insert(data.end(), chunk, chunk + size);
+			progress.report(worker, p, i, (uint32_t)k, ROLL_FILE_DOWNLOADING, nullptr, data.size(), 0);
+			return !progress.cancelled;
+		});
+		if (status == HttpCancelled) {
+			return false;
+		}
+		if (status != HttpOk) {
+			progress.report(worker, p, i, (uint32_t)k, file_status_from_http(status), http_status_error(status), 0, 0);
+			continue;
+		}
+		if (crc32_calc(data.data(), data.size()) != *file.crc32) {
+			progress.report(worker, p, i, (uint32_t)k, ROLL_FILE_CRC32_ERROR, nullptr, data.size(), data.size());
+			continue;
+		}
+		return true;
+	}
+	return false;
+}
+
+static bool stat_file(const std::string& path, uint64_t& size, uint64_t& mtime)
+{
+	fs::path fs_path = fs::u8path(path);
+	std::error_code ec;
+	if (!fs::is_regular_file(fs_path, ec)) {
+		return false;
+	}
+	size = fs::file_size(fs_path, ec);
+	if (ec) {
+		return false;
+	}
+	fs::file_time_type time = fs::last_write_time(fs_path, ec);
+	mtime = (uint64_t)time.time_since_epoch().count();
+	return !ec;
+}
+
+static bool read_file(const std::string& path, std::vector<uint8_t>& out)
+{
+	std::ifstream file(fs::u8path(path), std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+	out.resize((size_t)file.tellg());
+	file.seekg(0);
+	file.read((char*)out.data(), out.size());
+	return (size_t)file.gcount() == out.size();
+}
+
+// Whether [path] exists with [crc32]. The file is only read if [cache]
+// doesn't know its CRC32 for its current size and modification time.
+static bool local_file_matches(const std::string& path, uint32_t crc32, stat_cache_t* cache)
+{
+	uint64_t size;
+	uint64_t mtime;
+	if (!stat_file(path, size, mtime)) {
+		return false;
+	}
+	uint32_t local_crc32;
+	if (cache && cache->lookup(path, size, mtime, local_crc32)) {
+		return local_crc32 == crc32;
+	}
+	std::vector<uint8_t> local;
+	if (!read_file(path, local)) {
+		return false;
+	}
+	local_crc32 = crc32_calc(local.data(), local.size());
+	if (cache && local.size() == size) {
+		cache->store(path, size, mtime, local_crc32);
+	}
+	return local_crc32 == crc32;
+}
+
+// Writes [data] to file [i] of [p], or hardlinks [link_source] there if
+// given and possible.
+static bool materialize_file(const roll_patch_t& p, size_t i, const std::vector<uint8_t>& data, const char* link_source)
+{
+	fs::path path = fs::u8path(roll_path(p, i));
+	std::error_code ec;
+	fs::create_directories(path.parent_path(), ec);
+	if (link_source) {
+		fs::remove(path, ec);
+		fs::create_hard_link(fs::u8path(link_source), path, ec);
+		if (!ec) {
+			return true;
+		}
+	}
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	// An empty vector may not have any buffer to point to
+	if (!data.empty()) {
+		file.write((const char*)data.data(), data.size());
+	}
+	file.close();
+	return !file.fail();
+}
+
+// Brings every file of [blob] up to date. Files that are already current
+// are left alone. The content for the others comes from one of those if
+// there is one, then from the store, or else is downloaded once.
+static void update_blob(roll_blob_t& blob, unsigned worker, const roll_update_t& update, roll_progress_t& progress, roll_counters_t& counters)
+{
+	trace_span_t span("file");
+	if (span.recording()) {
+		const auto& [p, i] = blob.members[0];
+		span.arg("fn", roll_path(*p, i));
+		span.arg("copies", (int64_t)blob.members.size());
+	}
+	std::vector<uint8_t> data;
+	std::string source;
+	std::vector<std::pair<roll_patch_t*, size_t>> stale;
+	for (const auto& [p, i] : blob.members) {
+		std::string path = roll_path(*p, i);
+		if (local_file_matches(path, blob.crc32, update.stat_cache)) {
+			p->current[i] = 1;
+			progress.processed++;
+			if (source.empty()) {
+				source = path;
+			}
+		}
+		else {
+			stale.emplace_back(p, i);
+		}
+	}
+	if (stale.empty() || progress.cancelled) {
+		return;
+	}
+
+	// Only read now that it's needed. The stat cache could be wrong if the
+	// file was changed without changing its size or modification time.
+	if (!source.empty() && !(read_file(source, data) && crc32_calc(data.data(), data.size()) == blob.crc32)) {
+		source.clear();
+	}
+
+	bool have_data = !source.empty();
+	// Every member has the same path inside its patch, and whatever patch
+	// put it into the store will do
+	const std::string& fn = blob.members[0].first->files[blob.members[0].second].fn;
+	bool restored = !have_data && update.store && update.store->get(fn, blob.crc32, data);
+	have_data = have_data || restored;
+	// Any patch that has the file will do
+	for (size_t s = 0; !have_data && s < stale.size() && !progress.cancelled; s++) {
+		have_data = download_file(*stale[s].first, stale[s].second, worker, progress, data);
+		if (have_data) {
+			counters.downloaded++;
+			counters.downloaded_bytes += data.size();
+			// Written first, so that the others can be linked to it
+			std::swap(stale[0], stale[s]);
+		}
+	}
+	if (have_data && source.empty() && !restored && update.store) {
+		update.store->put(fn, blob.crc32, data.data(), data.size());
+	}
+
+	// The first file written from a download or the store doesn't count
+	// as deduplicated
+	bool downloaded = source.empty();
+	for (const auto& [p, i] : stale) {
+		bool ok = have_data && !progress.cancelled;
+		if (ok) {
+			const char* link_source = update.hardlink && !source.empty() ? source.c_str() : nullptr;
+			ok = materialize_file(*p, i, data, link_source);
+			if (!ok) {
+				progress.report(worker, *p, i, ROLL_SOURCE_LOCAL, ROLL_FILE_SYSTEM_ERROR, "couldn't write the file", data.size(), data.size());
+			}
+		}
+		if (!ok) {
+			counters.failed++;
+			if (blob.priority == PRIORITY_LAUNCH) {
+				counters.failed_launch++;
+			}
+			continue;
+		}
+		p->current[i] = 1;
+		progress.processed++;
+		uint64_t size;
+		uint64_t mtime;
+		if (update.stat_cache && stat_file(roll_path(*p, i), size, mtime)) {
+			update.stat_cache->store(roll_path(*p, i), size, mtime, blob.crc32);
+		}
+		if (downloaded) {
+			downloaded = false;
+			if (restored) {
+				counters.restored++;
+				counters.restored_bytes += data.size();
+			}
+		}
+		else {
+			counters.deduplicated++;
+			counters.saved_bytes += data.size();
+		}
+		if (source.empty()) {
+			source = roll_path(*p, i);
+		}
+		progress.report(worker, *p, i, PROGRESS_NO_SOURCE, ROLL_FILE_OK, nullptr, data.size(), data.size());
+	}
+}
+
+roll_update_stats_t roll_update(std::vector<roll_update_patch_t>& stack, const roll_update_t& update)
+{
+	trace_span_t span("update");
+	roll_update_stats_t stats;
+	std::vector<roll_patch_t> patches(stack.size());
+	for (size_t i = 0; i < stack.size(); i++) {
+		patches[i].patch = &stack[i];
+	}
+
+	std::vector<uint8_t> listed(patches.size());
+	parallel_for(patches.size(), update.jobs, [&](size_t i, unsigned) {
+		roll_patch_t& p = patches[i];
+		listed[i] = fetch_files_js(p);
+		p.patch->games.reset();
+		for (size_t j = 0; listed[i] && update.games && j < p.files.size(); j++) {
+			update.games->match(p.files[j].fn, p.patch->games);
+		}
+	});
+
+	// The plan: every unique file of the whole stack, in stack order
+	std::vector<roll_blob_t> blobs;
+	std::map<std::pair<uint32_t, std::string_view>, size_t> blob_ids;
+	std::vector<std::pair<roll_patch_t*, size_t>> deletions;
+	size_t missing_lists = 0;
+	for (size_t i = 0; i < patches.size(); i++) {
+		roll_patch_t& p = patches[i];
+		if (!listed[i]) {
+			missing_lists++;
+			continue;
+		}
+		for (size_t j = 0; j < p.files.size(); j++) {
+			const roll_file_t& file = p.files[j];
+			if (update.filter && !update.filter(file.fn.c_str())) {
+				continue;
+			}
+			stats.files++;
+			if (!file.crc32) {
+				deletions.emplace_back(&p, j);
+				continue;
+			}
+			roll_priority_t priority = PRIORITY_LAUNCH;
+			if (update.games) {
+				game_set_t owners;
+				update.games->match(file.fn, owners);
+				if (owners.any() && !owners[update.game_bit]) {
+					priority = PRIORITY_FILL;
+				}
+			}
+			auto [it, inserted] = blob_ids.try_emplace({ *file.crc32, file.fn }, blobs.size());
+			if (inserted) {
+				blobs.push_back({ *file.crc32 });
+			}
+			roll_blob_t& blob = blobs[it->second];
+			blob.members.emplace_back(&p, j);
+			if (priority < blob.priority) {
+				blob.priority = priority;
+			}
+		}
+	}
+
+	for (const auto& [p, j] : deletions) {
+		std::error_code ec;
+		fs::remove(fs::u8path(roll_path(*p, j)), ec);
+		p->current[j] = 1;
+	}
+
+	roll_progress_t progress(update, patches, stats.files - deletions.size());
+	roll_counters_t counters;
+	job_scheduler_t scheduler;
+	for (roll_blob_t& blob : blobs) {
+		scheduler.add(blob.priority, [&](unsigned worker) {
+			update_blob(blob, worker, update, progress, counters);
+		});
+	}
+	if (update.games && update.on_launchable) {
+		scheduler.milestone(PRIORITY_LAUNCH, [&] {
+			update.on_launchable(counters.failed_launch + missing_lists);
+		});
+	}
+	{
+		trace_span_t download_span("download");
+		download_span.arg("files", (int64_t)blobs.size());
+		scheduler.run(update.jobs);
+	}
+	// Every report is out before the caller prints its summary
+	if (progress.reporter) {
+		progress.reporter->stop();
+	}
+
+	for (size_t i = 0; i < patches.size(); i++) {
+		roll_patch_t& p = patches[i];
+		p.patch->listed = listed[i];
+		p.patch->current.clear();
+		for (size_t j = 0; j < p.files.size(); j++) {
+			if (p.current[j]) {
+				p.patch->current.emplace_back(std::move(p.files[j].fn), p.files[j].crc32);
+			}
+		}
+	}
+
+	stats.downloaded = counters.downloaded;
+	stats.downloaded_bytes = counters.downloaded_bytes;
+	stats.deduplicated = counters.deduplicated;
+	stats.saved_bytes = counters.saved_bytes;
+	stats.restored = counters.restored;
+	stats.restored_bytes = counters.restored_bytes;
+	stats.failed = counters.failed + missing_lists;
+	return stats;
+}
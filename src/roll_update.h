@@ -0,0 +1,129 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Downloading the files of a rolled patch stack
+  */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "blob_store.h"
+#include "game_match.h"
+#include "stat_cache.h"
+
+// What happened to a file, like thcrap's get_status_t
+enum roll_file_status_t {
+	ROLL_FILE_DOWNLOADING,
+	ROLL_FILE_OK,
+	ROLL_FILE_CLIENT_ERROR,
+	ROLL_FILE_SERVER_ERROR,
+	ROLL_FILE_SYSTEM_ERROR,
+	ROLL_FILE_CRC32_ERROR,
+	ROLL_FILE_CANCELLED,
+};
+
+// One patch of the stack
+struct roll_update_patch_t
+{
+	std::string id;
+	// Local directory, as patch_build() gives it, ending with a slash
+	std::string archive;
+	// As in patch.js, each ending with a slash
+	std::vector<std::string> servers;
+
+	// Filled in by roll_update(): whether files.js could be downloaded,
+	// and every file that is now up to date on disk, with its CRC32, or
+	// nothing if it was deleted. The same as what thcrap's own updater
+	// records in the local files.js.
+	bool listed = false;
+	std::vector<std::pair<std::string, std::optional<uint32_t>>> current;
+	// FNV-1a of the files.js that was downloaded, as in game_index_entry_t
+	uint64_t files_js_hash = 0;
+	// Every game out of roll_update_t::games that one of its files belongs
+	// to, whether or not the filter let them through. Only if [games] is
+	// set.
+	game_set_t games;
+};
+
+struct roll_progress_status_t
+{
+	const roll_update_patch_t* patch;
+	const char* fn;
+	// The server URL, or the local path if the file couldn't be written.
+	// nullptr if the file didn't come from a server.
+	const char* url;
+	roll_file_status_t status;
+	const char* error;
+	size_t file_progress;
+	size_t file_size;
+	size_t nb_files_downloaded;
+	size_t nb_files_total;
+};
+
+struct roll_update_t
+{
+	// Which files to download. Every file if not set.
+	std::function<bool(const char* fn)> filter;
+	// Called from one thread of its own, never from two at once, so it
+	// doesn't need any locking. ROLL_FILE_DOWNLOADING is only reported once
+	// every [progress_interval] per file, starting one interval after the
+	// download did. Returning false cancels the update, although files
+	// that are already being downloaded can still be reported after that.
+	std::function<bool(const roll_progress_status_t& status)> progress_callback;
+	std::chrono::steady_clock::duration progress_interval = std::chrono::seconds(5);
+	unsigned jobs = 16;
+
+	// If set, the files this game needs are downloaded before anything
+	// else: its own files, and global files that don't belong to any
+	// other game in [games].
+	const game_table_t* games = nullptr;
+	int game_bit = -1;
+	// Called once all of those are on disk, with the number of them that
+	// couldn't be downloaded
+	std::function<void(size_t failed)> on_launchable;
+
+	// Files that several patches have at the same path with the same
+	// CRC32 are downloaded once and then copied. With this set, they are
+	// hardlinked instead, which saves disk space, but thcrap's own updater
+	// overwrites files in place, so an update of one patch would then also
+	// change the others.
+	bool hardlink = false;
+
+	// Checked before downloading anything, and filled with every download
+	blob_store_t* store = nullptr;
+	// Lets local files that haven't changed be checked without reading them
+	stat_cache_t* stat_cache = nullptr;
+};
+
+struct roll_update_stats_t
+{
+	// Files that passed the filter
+	size_t files = 0;
+	size_t downloaded = 0;
+	size_t downloaded_bytes = 0;
+	// Files that were copied from the same path with the same CRC32 in
+	// another patch instead of being downloaded again. Identical files at
+	// different paths aren't counted, since they are downloaded each.
+	size_t deduplicated = 0;
+	size_t saved_bytes = 0;
+	// Files that were taken from the store instead of being downloaded
+	size_t restored = 0;
+	size_t restored_bytes = 0;
+	size_t failed = 0;
+};
+
+// Updates every patch in [stack] from its servers, through the current
+// transport, like stack_update_wrapper(), but schedules the files of all
+// patches together, and downloads files that several patches share only
+// once. Files only count as shared if they also have the same path in
+// each patch.
+roll_update_stats_t roll_update(std::vector<roll_update_patch_t>& stack, const roll_update_t& update);
@@ -9,13 +9,34 @@
 
 
 #include <thcrap.h>
+#include <algorithm>
 #include <array>
-#include <list>
-#include <map>
+#include <ctime>
+#include <future>
+#include <optional>
 #include <vector>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <thcrap_update_wrapper.h>
+#include "arena.h"
+#include "blacklist.h"
+#include "catalog.h"
+#include "exclusion.h"
+#include "files_js.h"
+#include "game_index.h"
+#include "patch_graph.h"
+#include "repo_crawl.h"
+#include "repo_snapshot.h"
+#include "roll.h"
+#include "roll_update.h"
+#include "sampler.h"
+#include "sel_stack.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include "transport.h"
+#include "transport_mirror.h"
+#include "transport_mock.h"
 
 #include <win32_utf8/entry_main.c>
 
@@ -23,16 +44,123 @@ namespace crsh {
 #include "exception.cpp"
 }
 
-// From select.cpp from thcrap_configure
-typedef std::list<patch_desc_t> patch_sel_stack_t;
-
-struct progress_state_t
+struct roulette_options_t
 {
-	// This callback can be called from a bunch of threads
-	std::mutex mutex;
-	std::map<std::string, std::chrono::steady_clock::time_point> files;
+	// Maximum number of files.js downloads in flight during the game filter
+	unsigned jobs = 16;
+	// Seconds after which the files.js of an indexed patch is checked again
+	int64_t index_max_age = 7 * 24 * 60 * 60;
+	// Up to this age, the repo snapshot is used as is
+	int64_t repo_max_age = 60 * 60;
+	// Up to this age, the repo snapshot is used while a new one is
+	// downloaded in the background. Older snapshots are only used if
+	// discovery fails.
+	int64_t repo_max_stale = 30 * 24 * 60 * 60;
+	// Ignore the repo snapshot and the patch index
+	bool refresh = false;
+	// Seed for the roll. Taken from the clock if not given.
+	bool has_seed = false;
+	uint64_t seed = 0;
+	// --repo-weight and --patch-weight, applied on top of blacklist.json
+	std::vector<std::pair<std::string, double>> repo_weights;
+	std::vector<std::pair<std::string, double>> patch_weights;
+	// Hardlink files that several patches share, instead of copying them
+	bool hardlink = false;
+	// Size cap of the local file store. 0 disables the store.
+	uint64_t store_max_bytes = (uint64_t)1024 * 1024 * 1024;
+	// "gc" subcommand: only trim the store to its cap
+	bool gc = false;
+	// Read everything from this directory instead of the network
+	std::string mirror;
+	// Put a simulated network in front of the network or the mirror
+	bool mock = false;
+	mock_transport_options_t mock_options;
+	// Write a Chrome trace of the whole roll to this file
+	std::string trace;
 };
 
+// Splits "<key>=<weight>"
+bool parse_weight_arg(const char* arg, std::vector<std::pair<std::string, double>>& weights)
+{
+	const char* eq = strrchr(arg, '=');
+	if (!eq || eq == arg) {
+		return false;
+	}
+	double weight = atof(eq + 1);
+	if (weight < 0.0) {
+		return false;
+	}
+	weights.emplace_back(std::string(arg, eq - arg), weight);
+	return true;
+}
+
+void parse_options(roulette_options_t& options, int argc, const char** argv)
+{
+	for (int i = 1; i < argc; i++) {
+		if ((strcmp(argv[i], "--jobs") == 0 || strcmp(argv[i], "-j") == 0) && i + 1 < argc) {
+			int jobs = atoi(argv[++i]);
+			options.jobs = jobs > 0 ? jobs : 1;
+		}
+		else if (strcmp(argv[i], "--index-max-age") == 0 && i + 1 < argc) {
+			// In hours on the command line
+			options.index_max_age = (int64_t)atoi(argv[++i]) * 60 * 60;
+		}
+		else if (strcmp(argv[i], "--refresh") == 0) {
+			options.refresh = true;
+		}
+		else if (strcmp(argv[i], "gc") == 0) {
+			options.gc = true;
+		}
+		else if (strcmp(argv[i], "--store-max-mb") == 0 && i + 1 < argc) {
+			options.store_max_bytes = strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+		}
+		else if (strcmp(argv[i], "--hardlink") == 0) {
+			options.hardlink = true;
+		}
+		else if (strcmp(argv[i], "--mirror") == 0 && i + 1 < argc) {
+			options.mirror = argv[++i];
+		}
+		else if (strcmp(argv[i], "--mock-latency") == 0 && i + 1 < argc) {
+			options.mock_options.latency_ms = atof(argv[++i]);
+			options.mock = true;
+		}
+		else if (strcmp(argv[i], "--mock-jitter") == 0 && i + 1 < argc) {
+			options.mock_options.jitter_ms = atof(argv[++i]);
+			options.mock = true;
+		}
+		else if (strcmp(argv[i], "--mock-bandwidth") == 0 && i + 1 < argc) {
+			// In KiB/s on the command line
+			options.mock_options.bandwidth = atof(argv[++i]) * 1024.0;
+			options.mock = true;
+		}
+		else if (strcmp(argv[i], "--mock-error-rate") == 0 && i + 1 < argc) {
+			options.mock_options.error_rate = atof(argv[++i]);
+			options.mock = true;
+		}
+		else if (strcmp(argv[i], "--mock-seed") == 0 && i + 1 < argc) {
+			options.mock_options.seed = strtoull(argv[++i], nullptr, 10);
+			options.mock = true;
+		}
+		else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			options.trace = argv[++i];
+		}
+		else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			options.seed = strtoull(argv[++i], nullptr, 10);
+			options.has_seed = true;
+		}
+		else if (strcmp(argv[i], "--repo-weight") == 0 && i + 1 < argc) {
+			if (!parse_weight_arg(argv[++i], options.repo_weights)) {
+				printf("Ignoring invalid weight \"%s\"\n", argv[i]);
+			}
+		}
+		else if (strcmp(argv[i], "--patch-weight") == 0 && i + 1 < argc) {
+			if (!parse_weight_arg(argv[++i], options.patch_weights)) {
+				printf("Ignoring invalid weight \"%s\"\n", argv[i]);
+			}
+		}
+	}
+}
+
 char** games_json_to_array(json_t* games, const char* game)
 {
 	char** array;
@@ -52,51 +180,48 @@ char** games_json_to_array(json_t* games, const char* game)
 	return array;
 }
 
-bool progress_callback(progress_callback_status_t* status, void* param)
+// roll_update() only calls this from one thread, and already throttles the
+// "in progress" reports of every file.
+bool progress_callback(const roll_progress_status_t& status)
 {
-	using namespace std::literals;
-	progress_state_t* state = (progress_state_t*)param;
-	std::scoped_lock lock(state->mutex);
-
-	switch (status->status) {
-	case GET_DOWNLOADING: {
-		// Using the URL instead of the filename is important, because we may
-		// be downloading the same file from 2 different URLs, and the UI
-		// could quickly become very confusing, with progress going backwards etc.
-		auto& file_time = state->files[status->url];
-		auto now = std::chrono::steady_clock::now();
-		if (file_time.time_since_epoch() == 0ms) {
-			file_time = now;
-		}
-		else if (now - file_time > 5s) {
-			log_printf("[%u/%u] %s: in progress (%ub/%ub)...\n", status->nb_files_downloaded, status->nb_files_total,
-				status->url, status->file_progress, status->file_size);
-			file_time = now;
-		}
+	switch (status.status) {
+	case ROLL_FILE_DOWNLOADING:
+		// The URL rather than the filename, because the same file may be
+		// downloaded from 2 different URLs, and progress going backwards
+		// would be very confusing.
+		log_printf("[%zu/%zu] %s: in progress (%zub/%zub)...\n", status.nb_files_downloaded, status.nb_files_total,
+			status.url, status.file_progress, status.file_size);
 		return true;
-	}
 
-	case GET_OK:
-		log_printf("[%u/%u] %s/%s: OK (%ub)\n", status->nb_files_downloaded, status->nb_files_total, status->patch->id, status->fn, status->file_size);
+	case ROLL_FILE_OK:
+		log_printf("[%zu/%zu] %s/%s: OK (%zub)\n", status.nb_files_downloaded, status.nb_files_total, status.patch->id.c_str(), status.fn, status.file_size);
 		return true;
 
-	case GET_CLIENT_ERROR:
-	case GET_SERVER_ERROR:
-	case GET_SYSTEM_ERROR:
-		log_printf("%s: %s\n", status->url, status->error);
+	case ROLL_FILE_CLIENT_ERROR:
+	case ROLL_FILE_SERVER_ERROR:
+	case ROLL_FILE_SYSTEM_ERROR:
+		log_printf("%s: %s\n", status.url, status.error);
 		return true;
-	case GET_CRC32_ERROR:
-		log_printf("%s: CRC32 error\n", status->url);
+	case ROLL_FILE_CRC32_ERROR:
+		log_printf("%s: CRC32 error\n", status.url);
 		return true;
-	case GET_CANCELLED:
+	case ROLL_FILE_CANCELLED:
 		// Another copy of the file have been downloader earlier. Ignore.
 		return true;
 	default:
-		log_printf("%s: unknown status\n", status->url);
+		log_printf("%s: unknown status\n", status.url);
 		return true;
 	}
 }
 
+// Everything that update_filter_global_wrapper() or
+// update_filter_games_wrapper() would download, with [filter_data] being
+// the list of games for the latter.
+int update_filter_roll(const char* fn, void* filter_data)
+{
+	return update_filter_global_wrapper(fn, nullptr) || update_filter_games_wrapper(fn, filter_data);
+}
+
 int file_write_text(const char* fn, const char* str)
 {
 	int ret;
@@ -109,142 +234,189 @@ int file_write_text(const char* fn, const char* str)
 	return ret;
 }
 
-bool sel_match(const patch_desc_t& a, const patch_desc_t& b)
+const repo_patch_t* find_patch_in_repo(const repo_t* repo, const char* patch_id)
 {
-	bool absolute;
-	bool repo_match;
-	bool patch_match;
-
-	absolute = a.repo_id && b.repo_id;
-
-	if (absolute) {
-		repo_match = (strcmp(a.repo_id, b.repo_id) == 0);
-	}
-	else {
-		repo_match = true;
+	for (size_t i = 0; repo && repo->patches[i].patch_id; i++) {
+		if (strcmp(repo->patches[i].patch_id, patch_id) == 0) {
+			return &repo->patches[i];
+		}
 	}
-
-	patch_match = (strcmp(a.patch_id, b.patch_id) == 0);
-
-	return repo_match && patch_match;
+	return nullptr;
 }
 
-repo_t* find_repo_in_list(repo_t** repo_list, const char* repo_id)
+// Indexes every repo in [repo_list] and its patches, in list order
+void catalog_from_repos(catalog_t& catalog, repo_t** repo_list)
 {
-	for (size_t i = 0; repo_list[i]; i++) {
-		if (strcmp(repo_list[i]->id, repo_id) == 0) {
-			return repo_list[i];
+	for (size_t i = 0; repo_list && repo_list[i]; i++) {
+		uint32_t repo = catalog.add_repo(repo_list[i]->id);
+		for (size_t j = 0; repo_list[i]->patches[j].patch_id; j++) {
+			catalog.add_patch(repo, repo_list[i]->patches[j].patch_id);
 		}
 	}
-	return nullptr;
+	catalog.finish();
 }
 
-const repo_patch_t* find_patch_in_repo(const repo_t* repo, const char* patch_id)
+// Writes the patch.js that [graph] downloaded for [node], then hands the
+// patch over to thcrap's stack, the same way patch_bootstrap_wrapper() and
+// thcrap_configure would have.
+void stack_add_graph_node(patch_graph_t& graph, uint32_t node)
 {
-	for (size_t i = 0; repo && repo->patches[i].patch_id; i++) {
-		if (strcmp(repo->patches[i].patch_id, patch_id) == 0) {
-			return &repo->patches[i];
+	patch_desc_t sel = { (char*)graph.repo_id(node), (char*)graph.patch_id(node) };
+	patch_t info = patch_build(&sel);
+	if (const std::vector<uint8_t>* patch_js = graph.patch_js(node)) {
+		std::string fn = info.archive;
+		fn += "patch.js";
+		file_write(fn.c_str(), patch_js->data(), patch_js->size());
+	}
+	patch_t patch = patch_init(info.archive, nullptr, 0);
+	patch_free(&info);
+
+	// Every dependency gets the repo it resolved to. thcrap owns them and
+	// frees them with free(), so they can't come from the arena.
+	const std::vector<patch_dependency_t>& deps = graph.dependencies(node);
+	const std::vector<uint32_t>& targets = graph.targets(node);
+	for (size_t i = 0; patch.dependencies && patch.dependencies[i].patch_id && i < targets.size(); i++) {
+		patch_desc_t& dep_sel = patch.dependencies[i];
+		if (targets[i] != DEP_UNMET && deps[i].patch_id == dep_sel.patch_id) {
+			free(dep_sel.repo_id);
+			dep_sel.repo_id = strdup(graph.repo_id(targets[i]));
 		}
 	}
-	return nullptr;
+	stack_add_patch(&patch);
 }
 
-// Locates a repository for [sel] in [repo_list], starting from [orig_repo_id].
-std::string SearchPatch(repo_t** repo_list, const char* orig_repo_id, const patch_desc_t& sel)
+// Records the files that are now up to date in the local files.js of [p],
+// the same way thcrap's own updater does, so that it won't download them
+// again.
+void save_local_files_js(const roll_update_patch_t& p)
 {
-	const repo_t* orig_repo = find_repo_in_list(repo_list, orig_repo_id);
-
-	// Absolute dependency
-	// In fact, just a check to see whether [sel] is available.
-	if (sel.repo_id) {
-		repo_t* remote_repo = find_repo_in_list(repo_list, sel.repo_id);
-		if (remote_repo) {
-			const repo_patch_t* patch = find_patch_in_repo(remote_repo, sel.patch_id);
-			if (patch) {
-				return remote_repo->id;
-			}
-		}
-		return "";
+	std::string fn = p.archive + "files.js";
+	json_t* local = json_load_file(fn.c_str(), 0, nullptr);
+	if (!json_is_object(local)) {
+		json_decref(local);
+		local = json_object();
 	}
-
-	// Relative dependency
-	if (find_patch_in_repo(orig_repo, sel.patch_id)) {
-		return orig_repo_id;
+	for (const auto& [file_fn, crc32] : p.current) {
+		json_object_set_new(local, file_fn.c_str(), crc32 ? json_integer(*crc32) : json_null());
 	}
+	json_dump_file(local, fn.c_str(), JSON_INDENT(2));
+	json_decref(local);
+}
 
-	for (size_t i = 0; repo_list[i]; i++) {
-		if (find_patch_in_repo(repo_list[i], sel.patch_id)) {
-			return repo_list[i]->id;
+// Every patch in [repos] that isn't excluded, in list order
+std::vector<roll_candidate_t> collect_patches(repo_t** repos, const exclusion_set_t& repo_exclude, const exclusion_set_t& patch_exclude)
+{
+	std::vector<roll_candidate_t> patches;
+	for (uint32_t i = 0; repos[i] != NULL; ++i) {
+		for (int j = 0; repos[i]->patches[j].patch_id != NULL; ++j) {
+			patches.push_back({ i, repos[i]->id, repos[i]->patches[j].patch_id });
 		}
 	}
-
-	// Not found...
-	return "";
+	roll_exclude(patches, repo_exclude, patch_exclude);
+	return patches;
 }
 
-bool IsSelected(const patch_sel_stack_t& sel_stack, const patch_desc_t& sel)
+// Downloads files.js again for every patch in [patches] whose entry in
+// [index] is missing or stale. Patches whose files.js can't be downloaded
+// are left out of the index.
+void game_index_refresh(game_index_t& index, repo_t** repos, const std::vector<roll_candidate_t>& patches, const roulette_options_t& options, bool announce)
 {
-	for (const patch_desc_t& it : sel_stack) {
-		if (sel_match(sel, it)) {
-			return true;
-		}
+	int64_t now = time(nullptr);
+
+	std::vector<game_index_source_t> sources;
+	sources.reserve(patches.size());
+	for (const roll_candidate_t& c : patches) {
+		const repo_t* repo = repos[c.repo];
+		const repo_patch_t* patch = find_patch_in_repo(repo, c.patch_id);
+		sources.push_back({ c.repo_id, c.patch_id, patch->title, repo->servers });
+	}
+	std::vector<size_t> stale = game_index_stale(index, sources, now, options.index_max_age);
+	if (stale.empty()) {
+		return;
 	}
-	return false;
+	if (announce) {
+		printf("Indexing %zu patches...\n", stale.size());
+	}
+	game_index_update(index, sources, stale, now, options.jobs);
 }
 
-int AddPatch(patch_sel_stack_t& sel_stack, repo_t** repo_list, patch_desc_t sel)
+struct discovery_t
 {
-	int ret = 0;
-	const repo_t* repo = find_repo_in_list(repo_list, sel.repo_id);
-	patch_t patch_info = patch_bootstrap_wrapper(&sel, repo);
-	patch_t patch_full = patch_init(patch_info.archive, nullptr, 0);
-	patch_desc_t* dependencies = patch_full.dependencies;
-
-	for (size_t i = 0; dependencies && dependencies[i].patch_id; i++) {
-		patch_desc_t dep_sel = dependencies[i];
-
-		if (!IsSelected(sel_stack, dep_sel)) {
-			std::string target_repo = SearchPatch(repo_list, sel.repo_id, dep_sel);
-			if (target_repo.empty()) {
-				log_printf("ERROR: Dependency '%s/%s' of patch '%s' not met!\n", dep_sel.repo_id, dep_sel.patch_id, sel.patch_id);
-				ret++;
-			}
-			else {
-				free(dep_sel.repo_id);
-				dep_sel.repo_id = strdup(target_repo.c_str());
-				dependencies[i] = dep_sel;
-				ret += AddPatch(sel_stack, repo_list, dep_sel);
+	repo_t** repos = nullptr;
+	// Built here, so that indexing the repos also overlaps the prompts
+	catalog_t catalog;
+	// Printed once the user is done with the prompts
+	std::string message;
+};
+
+// Loads the repo snapshot or crawls the network from [start_url],
+// depending on the age of the snapshot. If the snapshot is used while a
+// new one is downloaded, the thread doing that is moved to [revalidate].
+// Runs while the user answers the prompts, so it must not print anything.
+discovery_t discover_repos(const char* start_url, const roulette_options_t& options, std::thread& revalidate)
+{
+	trace_span_t span("discovery");
+	discovery_t ret;
+	if (transport_current() != curl_transport()) {
+		// A mirror or a simulated network doesn't get to replace the
+		// snapshot of the real one.
+		ret.repos = repo_snapshot_from_crawl(repo_crawl(start_url, options.jobs));
+		catalog_from_repos(ret.catalog, ret.repos);
+		return ret;
+	}
+
+	int64_t snapshot_age = 0;
+	repo_t** snapshot = nullptr;
+	if (!options.refresh) {
+		snapshot = repo_snapshot_load(REPO_SNAPSHOT_FN, start_url, &snapshot_age);
+	}
+
+	if (snapshot && snapshot_age < options.repo_max_age) {
+		ret.repos = snapshot;
+	}
+	else if (snapshot && snapshot_age < options.repo_max_stale) {
+		// Roll from the snapshot right away. The next run gets the new one.
+		ret.message = "Using the patchlist from " + std::to_string(snapshot_age / (60 * 60)) + " hours ago, and updating it in the background";
+		ret.repos = snapshot;
+		revalidate = std::thread([start_url, jobs = options.jobs] {
+			trace_span_t span("revalidate");
+			if (repo_t** fresh = repo_snapshot_from_crawl(repo_crawl(start_url, jobs))) {
+				repo_snapshot_save(REPO_SNAPSHOT_FN, start_url, fresh);
+				repo_snapshot_free(fresh);
 			}
+		});
+	}
+	else {
+		ret.repos = repo_snapshot_from_crawl(repo_crawl(start_url, options.jobs));
+		if (ret.repos) {
+			repo_snapshot_save(REPO_SNAPSHOT_FN, start_url, ret.repos);
+			repo_snapshot_free(snapshot);
+		}
+		else if (snapshot) {
+			ret.message = "Failed to download the patchlist, using an older copy";
+			ret.repos = snapshot;
+		}
+		else {
+			ret.repos = nullptr;
 		}
 	}
-
-	stack_add_patch(&patch_full);
-	sel_stack.push_back({ strdup(sel.repo_id), strdup(sel.patch_id) });
-	patch_free(&patch_info);
+	catalog_from_repos(ret.catalog, ret.repos);
 	return ret;
 }
 
-void add_remove_vector_string(std::vector<std::string>& vec, std::string str) {
-	bool removed = false;
-	for (unsigned int i = 0; i < vec.size(); i++) {
-		if (vec[i] == str) {
-			vec.erase(vec.begin() + i);
-			removed = true;
-			break;
-		}
+// Ends the trace started for --trace, if any
+void write_trace(const roulette_options_t& options)
+{
+	if (options.trace.empty()) {
+		return;
 	}
-	if (!removed) {
-		vec.push_back(str);
+	std::string trace = trace_stop();
+	if (file_write(options.trace.c_str(), trace.data(), trace.size()) == 0) {
+		printf("Trace written to %s\n", options.trace.c_str());
 	}
-}
-
-bool vector_string_contains(std::vector<std::string>& vec, const char* str) {
-	for (const std::string& _str : vec) {
-		if (strcmp(_str.c_str(), str) == 0) {
-			return true;
-		}
+	else {
+		printf("Couldn't write the trace to %s\n", options.trace.c_str());
 	}
-	return false;
 }
 
 const char* cmd_inp() {
@@ -265,15 +437,14 @@ const char* cmd_inp() {
 	return buf;
 }
 
-void exclusion_input(std::vector<std::string>& exclude) {
+void exclusion_input(exclusion_set_t& exclude) {
 	const char* inp = NULL;
 
 exclusion_input_start:
 	if (inp) free((void*)inp);
 	printf("Currently excluded: ");
-	for (const std::string& repo_name : exclude) {
-		printf(repo_name.c_str());
-		putchar(' ');
+	for (std::string_view repo_name : exclude.entries()) {
+		printf("%.*s ", (int)repo_name.size(), repo_name.data());
 	}
 	putchar('\n');
 	puts("Press ENTER without typing anything to proceed");
@@ -295,12 +466,12 @@ exclusion_input_start:
 
 		const char* l_ = strchr(l, ' ');
 		if (l_) {
-			add_remove_vector_string(exclude, std::string(l, l_ - l));
+			exclude.toggle(std::string_view(l, l_ - l));
 			l = l_;
 			goto search_inputs;
 		}
 		else {
-			add_remove_vector_string(exclude, l);
+			exclude.toggle(l);
 		}
 
 		goto exclusion_input_start;
@@ -329,6 +500,12 @@ yesno_begin:
 
 int TH_CDECL win32_utf8_main(int argc, const char** argv)
 {
+	roulette_options_t options;
+	parse_options(options, argc, argv);
+	if (!options.trace.empty()) {
+		trace_start();
+	}
+
 	AddVectoredExceptionHandler(0, crsh::exception_filter);
 	VLA(char, current_dir, MAX_PATH);
 	GetModuleFileNameU(NULL, current_dir, MAX_PATH);
@@ -337,6 +514,16 @@ int TH_CDECL win32_utf8_main(int argc, const char** argv)
 	SetCurrentDirectoryU(current_dir);
 	VLA_FREE(current_dir);
 
+	blob_store_t store(BLOB_STORE_DIR, options.store_max_bytes);
+	if (options.gc) {
+		store.load();
+		uint64_t freed = store.gc(options.store_max_bytes);
+		store.save();
+		printf("Freed %llu KiB, %zu files (%llu KiB) left in " BLOB_STORE_DIR "\n",
+			(unsigned long long)(freed + 1023) / 1024, store.count(), (unsigned long long)(store.size() + 1023) / 1024);
+		return 0;
+	}
+
 	if (!thcrap_update_module()) {
 		puts("thcrap_update" DEBUG_OR_RELEASE ".dll couldn't be loaded");
 		return 1;
@@ -344,126 +531,167 @@ int TH_CDECL win32_utf8_main(int argc, const char** argv)
 
 	const char* start_url = "https://srv.thpatch.net/";
 
-	// Copied from thcrap_wrapper/src/install_modules.c to fix linker error
-
-	// From thcrap_update/src/http_status.h
-	// Slightly modified since this is C
-	typedef enum HttpStatus {
-		// 200 - success
-		HttpOk,
-		// Download cancelled by the progress callback, or another client
-		// declared the server as dead
-		HttpCancelled,
-		// 3XX and 4XX - file not found, not accessible, moved, etc.
-		HttpClientError,
-		// 5XX errors - server errors, further requests are likely to fail.
-		// Also covers weird error codes like 1XX and 2XX which we shouldn't see.
-		HttpServerError,
-		// Error returned by the download library or by the write callback
-		HttpSystemError,
-		// Error encountered before loading thcrap_update.dll
-		HttpLibLoadError
-	} HttpStatus;
-
-	typedef HttpStatus download_single_file_t(const char* url, const char* fn);
-	HMODULE hUpdate = thcrap_update_module();
-	download_single_file_t* download_single_file = (download_single_file_t*)GetProcAddress(hUpdate, "download_single_file");
-	if (!download_single_file) {
-		puts("FATAL ERROR: thcrap version too old!");
-		getchar();
+	// Set up before anything is downloaded, and alive until the end
+	std::optional<mirror_transport_t> mirror;
+	std::optional<mock_transport_t> mock;
+	transport_t* transport = curl_transport();
+	if (!transport) {
+		puts("FATAL ERROR: libcurl couldn't be initialized!");
 		return 1;
 	}
+	if (!options.mirror.empty()) {
+		transport = &mirror.emplace(options.mirror);
+	}
+	if (options.mock) {
+		transport = &mock.emplace(options.mock_options, transport);
+	}
+	transport_use(transport);
 
-	std::vector<std::string> repo_exclude;
-	std::vector<std::string> patch_exclude;
+	// Discovery and the files.js prefetch run while the user answers the
+	// prompts. Only the final filtering waits for them.
+	CreateDirectoryU("roulette", NULL);
+	if (options.refresh) {
+		options.index_max_age = 0;
+	}
+	std::thread revalidate;
+	std::shared_future<discovery_t> discovery = std::async(std::launch::async, discover_repos, start_url, std::cref(options), std::ref(revalidate));
+
+	exclusion_set_t repo_exclude;
+	exclusion_set_t patch_exclude;
+	roll_weights_t weights;
+
+	// The last copy that was downloaded is used if the download fails.
+	{
+		trace_span_t span("blacklist");
+		std::vector<uint8_t> blacklist_js;
+		if (download_to_memory(BLACKLIST_URL, blacklist_js) == HttpOk) {
+			file_write("blacklist.json", blacklist_js.data(), blacklist_js.size());
+		}
+		else {
+			size_t blacklist_size = 0;
+			if (uint8_t* blacklist = (uint8_t*)file_read("blacklist.json", &blacklist_size)) {
+				blacklist_js.assign(blacklist, blacklist + blacklist_size);
+				free(blacklist);
+			}
+		}
+		if (blacklist_js.empty()) {
+			puts("Failed to download blacklist.json!");
+			puts("Proceeding with no default parch/repo exclusions\n");
+		}
+		else {
+			blacklist_parse(blacklist_js.data(), blacklist_js.size(), repo_exclude, patch_exclude, weights);
+		}
+	}
 
-	download_single_file("https://raw.githubusercontent.com/touhoureplayshowcase/thcrap_roulette/master/blacklist.json", "blacklist.json");
-	if (!PathFileExistsW(L"blacklist.json")) {
-		puts("Failed to download blacklist.json!");
-		puts("Proceeding with no default parch/repo exclusions\n");
-		goto after_blacklist_init;
+	for (const auto& [repo, weight] : options.repo_weights) {
+		weights.repos[repo] = weight;
 	}
-	json_t* blacklist = json_load_file("blacklist.json", 0, nullptr);
-	if (!json_is_object(blacklist)) goto after_blacklist_init;
+	for (const auto& [patch, weight] : options.patch_weights) {
+		weights.patches[patch] = weight;
+	}
+
 
-	json_t* repo_exclude_j = json_object_get(blacklist, "repo_exclude");
-	if(json_is_array(repo_exclude_j)) {
-		size_t i;
-		json_t* val;
-		json_array_foreach(repo_exclude_j, i, val) {
-			if (const char* repo = json_string_value(val))
-				repo_exclude.push_back(repo);
+	// Asked first, so that files.js can be prefetched during the other prompts
+	puts("Which game do you want to patch?");
+	puts("Press ENTER without typing anything to proceed");
+	char game_inp[16] = {};
+	fgets(game_inp, 16, stdin);
+	game_inp[strcspn(game_inp, "\n")] = 0;
+
+	game_index_t index;
+	int game_bit = -1;
+	std::future<void> prefetch;
+	if (*game_inp) {
+		game_index_load(index, GAME_INDEX_FN);
+
+		// Classify against every game in games.js too, so that the next
+		// roll for another one of them doesn't have to download anything.
+		json_t* games_js = json_load_file("config/games.js", 0, nullptr);
+		const char* game;
+		json_t* game_path;
+		json_object_foreach(games_js, game, game_path) {
+			index.games.add(game);
+		}
+		json_decref(games_js);
+
+		// Only games that thcrap, games.js or the index know about. Anything
+		// else can't be filtered for, and isn't worth indexing.
+		game_bit = index.games.find(game_inp);
+		if (game_bit < 0) {
+			printf("Unknown game %s, rolling from every patch\n", game_inp);
+			*game_inp = 0;
 		}
 	}
-
-	json_t* patch_exclude_j = json_object_get(blacklist, "patch_exclude");
-	if (json_is_array(patch_exclude_j)) {
-		size_t i;
-		json_t* val;
-		json_array_foreach(patch_exclude_j, i, val) {
-			if (const char* patch = json_string_value(val))
-				patch_exclude.push_back(patch);
+	if (*game_inp) {
+		// The index can't answer for a game it wasn't built for. Start over.
+		if (!index.covered[game_bit]) {
+			index.patches.clear();
+			index.covered = index.games.all();
 		}
+
+		// Speculatively uses the default exclusions. Anything the user
+		// brings back in is fetched after the prompts.
+		prefetch = std::async(std::launch::async, [&index, &options, discovery, repo_exclude, patch_exclude] {
+			repo_t** repos = discovery.get().repos;
+			if (!repos) {
+				return;
+			}
+			std::vector<roll_candidate_t> patches = collect_patches(repos, repo_exclude, patch_exclude);
+			game_index_refresh(index, repos, patches, options, false);
+		});
 	}
 
-	after_blacklist_init:
 	puts("Do you want exclude any patch repos from the roulette?");
 	puts("If you type the name of a repo already in this list, it will be removed from the list");
 	puts("You can also specify multiple repo names, separated by spaces");
+	puts("* and ? work as wildcards, e.g. th*prac or debug_*");
 	exclusion_input(repo_exclude);
 
 	puts("Do you want exclude any patches from the roulette?");
 	puts("If you type the name of a patch already in this list, it will be removed from the list");
 	puts("You can also specify multiple patch names, separated by spaces");
+	puts("* and ? work as wildcards, e.g. th*prac or debug_*");
 	exclusion_input(patch_exclude);
 
-	patch_exclude.push_back("anm_leak");
-	patch_exclude.push_back("debug_counters");
+	patch_exclude.add("anm_leak");
+	patch_exclude.add("debug_counters");
 
-	puts("Which game do you want to patch?");
-	puts("Press ENTER without typing anything to proceed");
-	char game_inp[16] = {};
-	fgets(game_inp, 16, stdin);
-	*strchr(game_inp, '\n') = 0;
-
-	if (strcmp(game_inp, "th18") == 0) patch_exclude.push_back("bullet-cap");
-
-	puts("Downloading patchlist...");
-	repo_t** repos = RepoDiscover_wrapper(start_url);
-
-	std::vector<patch_desc_t> patches;
-
-	for (int i = 0; repos[i] != NULL; ++i) {
-		if (!vector_string_contains(repo_exclude, repos[i]->id)) {
-			for (int j = 0; repos[i]->patches[j].patch_id != NULL; ++j) {
-				if (!vector_string_contains(patch_exclude, repos[i]->patches[j].patch_id)) {
-					if (*game_inp == 0) goto patches_push_back;
-
-					json_t* files_js = NULL;
-					for (int k = 0; repos[i]->servers[k]; ++k) {
-						std::string _url = repos[i]->servers[k];
-						_url += repos[i]->patches[j].patch_id;
-						_url += "/files.js";
-						HttpStatus status = download_single_file(_url.c_str(), "files.js");
-						if (status == HttpOk) {
-							files_js = json_load_file("files.js", 0, nullptr);
-							if (files_js) break;
-						}
-					}
-					if (!files_js) continue;
-					const char* fn;
-					json_t* crc;
-
-					json_object_foreach(files_js, fn, crc) {
-						if (strstr(fn, game_inp)) goto patches_push_back;
-					}
-					continue;
-					patches_push_back:
-					patches.push_back({ repos[i]->id, repos[i]->patches[j].patch_id });
-				}
-			}
+	if (strcmp(game_inp, "th18") == 0) patch_exclude.add("bullet-cap");
+
+	if (discovery.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+		puts("Downloading patchlist...");
+		trace_span_t span("discovery wait");
+		discovery.wait();
+	}
+	if (!discovery.get().message.empty()) {
+		puts(discovery.get().message.c_str());
+	}
+	repo_t** repos = discovery.get().repos;
+	const catalog_t& catalog = discovery.get().catalog;
+	if (!repos) {
+		puts("Failed to download the patchlist!");
+		getchar();
+		if (prefetch.valid()) {
+			prefetch.wait();
+		}
+		if (revalidate.joinable()) {
+			revalidate.join();
 		}
-	}	
+		write_trace(options);
+		return 1;
+	}
+
+	std::vector<roll_candidate_t> patches = collect_patches(repos, repo_exclude, patch_exclude);
+
+	if (*game_inp) {
+		trace_span_t span("game filter");
+		prefetch.get();
+		game_index_refresh(index, repos, patches, options, true);
+		game_index_prune(index, catalog);
+		game_index_save(index, GAME_INDEX_FN);
+		roll_filter_game(patches, index, game_bit);
+	}
+	std::vector<double> patch_weights = roll_apply_weights(patches, weights);
 
 	char _num_patches[8];
 	unsigned int num_patches;
@@ -477,59 +705,178 @@ sel_num_patches:
 	}
 	printf("%d patches\n\n", num_patches);
 
-	FILETIME _time;
-	GetSystemTimeAsFileTime(&_time);
-	srand(_time.dwLowDateTime);
-
-	patch_sel_stack_t stack;
-
-	for (unsigned int i = 0; i < num_patches; i++) {
-		int idx = rand() % patches.size();
-		patch_desc_t patch = patches[idx];
-		patches.erase(patches.begin() + idx);
-		AddPatch(stack, repos, patch);
+	if (!options.has_seed) {
+		FILETIME _time;
+		GetSystemTimeAsFileTime(&_time);
+		options.seed = (uint64_t)_time.dwHighDateTime << 32 | _time.dwLowDateTime;
+	}
+	printf("Seed: %llu (run with --seed %llu to roll the same patches again)\n\n", (unsigned long long)options.seed, (unsigned long long)options.seed);
+	rng_t rng(options.seed);
+	{
+		trace_span_t span("sampling");
+		roll_pick(patches, std::move(patch_weights), num_patches, rng);
 	}
-	
+
 	if(yes_no("Do you want to add anm_leak, a patch that fixes crash and lag issues related to rendering?"))
-		AddPatch(stack, repos, { "ExpHP", "anm_leak" });
+		patches.push_back({ CATALOG_NONE, "ExpHP", "anm_leak" });
 
 	if (yes_no("Do you want to add debug_counters, a patch that will show various information about the game's state?"))
-		AddPatch(stack, repos, { "ExpHP", "debug_counters" });
+		patches.push_back({ CATALOG_NONE, "ExpHP", "debug_counters" });
+
+	// Every pick and every layer of dependencies is downloaded at once.
+	// The stack is then built in the same order as adding them one by one.
+	sel_stack_t stack;
+	{
+		trace_span_t span("resolution");
+		// Released in one go once the stack is built
+		arena_t roll_arena;
+		patch_graph_t graph(catalog, [repos](uint32_t repo) { return repos[repo]->servers; }, roll_arena);
+		std::vector<uint32_t> roots;
+		for (const roll_candidate_t& pick : patches) {
+			roots.push_back(graph.node(pick.repo_id, pick.patch_id));
+		}
+		graph.prefetch(roots, options.jobs);
+
+		patch_graph_visitor_t visitor;
+		visitor.unmet = [&](uint32_t node, const patch_dependency_t& dep) {
+			log_printf("ERROR: Dependency '%s/%s' of patch '%s' not met!\n", dep.repo_id.empty() ? "(null)" : dep.repo_id.c_str(), dep.patch_id.c_str(), graph.patch_id(node));
+		};
+		visitor.cycle = [&](const std::vector<uint32_t>& path) {
+			std::string cycle;
+			for (uint32_t node : path) {
+				if (!cycle.empty()) {
+					cycle += " -> ";
+				}
+				cycle += game_index_key(graph.repo_id(node), graph.patch_id(node));
+			}
+			log_printf("ERROR: Dependency cycle: %s\n", cycle.c_str());
+		};
+		visitor.emit = [&](uint32_t node) {
+			stack_add_graph_node(graph, node);
+		};
+		for (uint32_t root : roots) {
+			graph.add(root, stack, visitor);
+		}
+		const arena_t::stats_t& stats = roll_arena.stats();
+		printf("Resolved %zu patches (%zu allocations, %zu KiB peak)\n\n", stack.size(), stats.allocations, (stats.peak_bytes + 1023) / 1024);
+	}
 
 	/// Build the new run configuration
-	json_t* new_cfg = json_pack("{s[]}", "patches");
-	json_t* new_cfg_patches = json_object_get(new_cfg, "patches");
-	for (patch_desc_t& sel : stack) {
-		patch_t patch = patch_build(&sel);
-		json_array_append_new(new_cfg_patches, patch_to_runconfig_json(&patch));
-		patch_free(&patch);
+	std::string run_cfg;
+	{
+		trace_span_t span("config write");
+		run_cfg = roll_runconfig_json(stack, game_inp, [](const char* repo_id, const char* patch_id) {
+			patch_desc_t sel = { (char*)repo_id, (char*)patch_id };
+			patch_t patch = patch_build(&sel);
+			json_t* entry = patch_to_runconfig_json(&patch);
+			char* entry_str = json_dumps(entry, JSON_SORT_KEYS);
+			std::string ret = entry_str ? entry_str : "{}";
+			free(entry_str);
+			json_decref(entry);
+			patch_free(&patch);
+			return ret;
+		});
+		file_write_text("config/random.js", run_cfg.c_str());
 	}
-	json_object_set_new(new_cfg, "console", json_false());
-	json_object_set_new(new_cfg, "dat_dump", json_false());
-	if (*game_inp) {
-		json_object_set_new(new_cfg, "game", json_string(game_inp));
-	}
-
-	const char* run_cfg_str = json_dumps(new_cfg, JSON_INDENT(2) | JSON_SORT_KEYS);
-	file_write_text("config/random.js", run_cfg_str);
 	puts("You rolled:");
-	puts(run_cfg_str);
+	puts(run_cfg.c_str());
 	puts("Saved to config/random.js. Press ENTER to start downloading");
 	puts("NOTE: only data for games already in your games.js will be downloaded");
 	free((void*)cmd_inp());
 
 	log_init(1);
-	progress_state_t state;
-	stack_update_wrapper(update_filter_global_wrapper, NULL, progress_callback, &state);
-	state.files.clear();
-
 	json_t* games_js = json_load_file_report("config/games.js");
 	char** filter = games_json_to_array(games_js, game_inp);
 
-	stack_update_wrapper(update_filter_games_wrapper, filter, progress_callback, &state);
-	state.files.clear();
+	// One pass, so that the global files and the game files share the
+	// download threads and nobody waits for the other's last few files.
+	// The files of the selected game go first.
+	roll_update_t update;
+	update.filter = [filter](const char* fn) {
+		return update_filter_roll(fn, filter) != 0;
+	};
+	update.progress_callback = progress_callback;
+	update.jobs = options.jobs;
+	update.hardlink = options.hardlink;
+	if (options.store_max_bytes) {
+		store.load();
+		update.store = &store;
+	}
+	stat_cache_t stat_cache;
+	stat_cache.load(STAT_CACHE_FN);
+	update.stat_cache = &stat_cache;
+	auto update_start = std::chrono::steady_clock::now();
+	if (*game_inp) {
+		update.games = &index.games;
+		update.game_bit = game_bit;
+		update.on_launchable = [&](size_t failed) {
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - update_start).count();
+			if (failed) {
+				log_printf("%s is missing %zu files, it might not launch correctly\n", game_inp, failed);
+			}
+			else {
+				log_printf("%s is launchable (%.1f s)\n", game_inp, seconds);
+			}
+		};
+	}
+	std::vector<roll_update_patch_t> update_patches(stack.size());
+	for (size_t i = 0; i < stack.size(); i++) {
+		patch_desc_t sel = { (char*)stack.repo_id(i), (char*)stack.patch_id(i) };
+		patch_t built = patch_build(&sel);
+		patch_t patch = patch_init(built.archive, nullptr, 0);
+		roll_update_patch_t& p = update_patches[i];
+		p.id = stack.patch_id(i);
+		p.archive = built.archive;
+		for (size_t k = 0; patch.servers && patch.servers[k]; k++) {
+			p.servers.push_back(patch.servers[k]);
+		}
+		patch_free(&patch);
+		patch_free(&built);
+	}
+	roll_update_stats_t stats = roll_update(update_patches, update);
+	size_t reindexed = 0;
+	for (size_t i = 0; i < update_patches.size(); i++) {
+		const roll_update_patch_t& p = update_patches[i];
+		if (!p.listed) {
+			log_printf("%s: couldn't download files.js\n", p.id.c_str());
+			continue;
+		}
+		save_local_files_js(p);
+		// The index is only loaded when rolling for a game
+		if (*game_inp && game_index_observe(index, game_index_key(stack.repo_id(i), stack.patch_id(i)), p.files_js_hash, p.games, time(nullptr))) {
+			reindexed++;
+		}
+	}
+	if (reindexed) {
+		// Patches whose files changed since they were indexed
+		game_index_save(index, GAME_INDEX_FN);
+	}
+	stat_cache.save(STAT_CACHE_FN);
+	log_printf("\n%zu files checked, %zu downloaded (%zu KiB)\n", stats.files, stats.downloaded, (stats.downloaded_bytes + 1023) / 1024);
+	if (update.store) {
+		blob_store_t::stats_t store_stats = store.stats();
+		size_t lookups = store_stats.hits + store_stats.misses;
+		log_printf("%zu files (%zu KiB) restored from the local store, %.0f%% hit rate\n", stats.restored, (stats.restored_bytes + 1023) / 1024,
+			lookups ? 100.0 * store_stats.hits / lookups : 0.0);
+		store.save();
+	}
+	if (stats.deduplicated) {
+		log_printf("%zu files that several patches have at the same path were only downloaded once, saving %zu KiB\n", stats.deduplicated, (stats.saved_bytes + 1023) / 1024);
+	}
+	if (stats.failed) {
+		log_printf("%zu files couldn't be downloaded\n", stats.failed);
+	}
+	if (mock) {
+		mock_transport_t::stats_t mock_stats = mock->stats();
+		log_printf("Simulated network: %zu requests, %zu failed, %llu KiB\n", mock_stats.requests, mock_stats.failed,
+			(unsigned long long)(mock_stats.bytes + 1023) / 1024);
+	}
 
 	log_flush();
+	if (revalidate.joinable()) {
+		revalidate.join();
+	}
+	write_trace(options);
 	puts("\n\nDone! You can now run roulette_launch.bat to lauch.\nPress ENTER to close");
 	free((void*)cmd_inp());
 
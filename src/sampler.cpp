@@ -0,0 +1,183 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Seeded random sampling
+  */
+
+#include <algorithm>
+#include "sampler.h"
+
+static uint64_t splitmix64(uint64_t& state)
+{
+	uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+static uint64_t rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+rng_t::rng_t(uint64_t seed)
+{
+	// Spreads any seed, even 0, over the whole state
+	for (uint64_t& word : s) {
+		word = splitmix64(seed);
+	}
+}
+
+uint64_t rng_t::next()
+{
+	uint64_t result = rotl(s[1] * 5, 7) * 9;
+	uint64_t t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+	return result;
+}
+
+uint64_t rng_t::below(uint64_t bound)
+{
+	// Rejects the top (2^64 mod bound) values, which would otherwise be
+	// picked slightly more often.
+	uint64_t threshold = (0 - bound) % bound;
+	for (;;) {
+		uint64_t r = next();
+		if (r >= threshold) {
+			return r % bound;
+		}
+	}
+}
+
+double rng_t::unit()
+{
+	return (next() >> 11) * 0x1.0p-53;
+}
+
+double alias_table_t::build(const double* weights, size_t count)
+{
+	scratch_t scratch;
+	return build(weights, count, scratch);
+}
+
+double alias_table_t::build(const double* weights, size_t count, scratch_t& scratch)
+{
+	slots.assign(count, { 0.0f, 0 });
+
+	double total = 0.0;
+	for (size_t i = 0; i < count; i++) {
+		total += weights[i];
+	}
+	if (total <= 0.0) {
+		return 0.0;
+	}
+
+	std::vector<uint32_t>& small = scratch.small;
+	std::vector<uint32_t>& large = scratch.large;
+	std::vector<double>& scaled = scratch.scaled;
+	small.clear();
+	large.clear();
+	scaled.resize(count);
+	uint32_t nonzero = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (weights[i] > 0.0) {
+			nonzero = (uint32_t)i;
+		}
+		scaled[i] = weights[i] * count / total;
+		(scaled[i] < 1.0 ? small : large).push_back((uint32_t)i);
+	}
+	while (!small.empty() && !large.empty()) {
+		uint32_t s = small.back();
+		uint32_t l = large.back();
+		small.pop_back();
+		slots[s] = { (float)scaled[s], l };
+		scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+		if (scaled[l] < 1.0) {
+			large.pop_back();
+			small.push_back(l);
+		}
+	}
+	// Whatever is left is 1 give or take rounding errors
+	for (uint32_t i : large) {
+		slots[i] = { 1.0f, i };
+	}
+	for (uint32_t i : small) {
+		slots[i] = weights[i] > 0.0 ? slot_t{ 1.0f, i } : slot_t{ 0.0f, nonzero };
+	}
+	return total;
+}
+
+size_t alias_table_t::draw(rng_t& rng) const
+{
+	size_t i = (size_t)rng.below(slots.size());
+	const slot_t& slot = slots[i];
+	return rng.unit() < slot.prob ? i : slot.alias;
+}
+
+weighted_sampler_t::weighted_sampler_t(std::vector<double> weights)
+{
+	levels.push_back({ std::move(weights) });
+	for (;;) {
+		level_t& level = levels.back();
+		size_t group_count = (level.weights.size() + SAMPLER_FANOUT - 1) / SAMPLER_FANOUT;
+		level.groups.resize(group_count);
+		std::vector<double> totals(group_count);
+		for (size_t g = 0; g < group_count; g++) {
+			totals[g] = build_group(level, g);
+		}
+		if (group_count <= 1) {
+			sum = group_count ? totals[0] : 0.0;
+			break;
+		}
+		levels.push_back({ std::move(totals) });
+	}
+}
+
+double weighted_sampler_t::build_group(level_t& level, size_t g)
+{
+	size_t first = g * SAMPLER_FANOUT;
+	size_t count = std::min((size_t)SAMPLER_FANOUT, level.weights.size() - first);
+	return level.groups[g].build(&level.weights[first], count, scratch);
+}
+
+size_t weighted_sampler_t::draw(rng_t& rng) const
+{
+	if (sum <= 0.0) {
+		return SIZE_MAX;
+	}
+	// Groups with a total of 0 are never drawn from the level above
+	size_t index = 0;
+	for (size_t l = levels.size(); l-- > 0;) {
+		index = index * SAMPLER_FANOUT + levels[l].groups[index].draw(rng);
+	}
+	return index;
+}
+
+void weighted_sampler_t::remove(size_t index)
+{
+	if (index >= levels[0].weights.size() || levels[0].weights[index] == 0.0) {
+		return;
+	}
+	levels[0].weights[index] = 0.0;
+	// Totals are rebuilt from the weights rather than subtracted, so that
+	// rounding errors can't leave a tiny chance of drawing a removed item.
+	for (size_t l = 0; l < levels.size(); l++) {
+		size_t g = index / SAMPLER_FANOUT;
+		double total = build_group(levels[l], g);
+		if (l + 1 < levels.size()) {
+			levels[l + 1].weights[g] = total;
+		}
+		else {
+			sum = total;
+		}
+		index = g;
+	}
+}
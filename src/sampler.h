@@ -0,0 +1,119 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Seeded random sampling
+  */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+// xoshiro256**. The same seed always gives the same sequence on every
+// platform, unlike rand().
+class rng_t
+{
+public:
+	explicit rng_t(uint64_t seed);
+
+	uint64_t next();
+	// Uniform in [0, bound), without modulo bias. [bound] must not be 0.
+	uint64_t below(uint64_t bound);
+	// Uniform in [0, 1)
+	double unit();
+
+private:
+	uint64_t s[4];
+};
+
+// Moves [k] uniformly chosen elements of [items] to its front, in the order
+// they were drawn, with a partial Fisher-Yates shuffle. O(k), and the
+// result only depends on [items] and the state of [rng].
+template <typename T>
+void sample_to_front(std::vector<T>& items, size_t k, rng_t& rng)
+{
+	size_t n = items.size();
+	if (k > n) {
+		k = n;
+	}
+	for (size_t i = 0; i < k; i++) {
+		size_t j = i + (size_t)rng.below(n - i);
+		std::swap(items[i], items[j]);
+	}
+}
+
+// Vose's alias method: O(n) to build, O(1) per draw.
+class alias_table_t
+{
+public:
+	// Working memory of build(), which can be kept around to rebuild
+	// tables without allocating
+	struct scratch_t
+	{
+		std::vector<uint32_t> small;
+		std::vector<uint32_t> large;
+		std::vector<double> scaled;
+	};
+
+	// [weights] must not be negative. Returns the sum of all weights.
+	// Rebuilding with the same [count] reuses the table's memory.
+	double build(const double* weights, size_t count);
+	double build(const double* weights, size_t count, scratch_t& scratch);
+	// Index drawn with a probability proportional to its weight. Must not
+	// be called if all weights are 0.
+	size_t draw(rng_t& rng) const;
+	size_t size() const { return slots.size(); }
+
+private:
+	// Kept together, so that a draw only touches one cache line
+	struct slot_t {
+		float prob;
+		uint32_t alias;
+	};
+	std::vector<slot_t> slots;
+};
+
+// Items per alias table of weighted_sampler_t
+#define SAMPLER_FANOUT 256
+
+// Weighted sampling without replacement, without rejection loops.
+// Items are split into groups of SAMPLER_FANOUT, each with its own alias
+// table. The totals of those groups are grouped the same way, level after
+// level, until one group is left. A draw goes down from that one through
+// an alias table on every level, which is 2 levels up to 64k items and 3
+// up to 16M. Removing an item rebuilds only the table of its group on
+// every level, in place, so its cost doesn't grow with the number of
+// items either.
+class weighted_sampler_t
+{
+public:
+	explicit weighted_sampler_t(std::vector<double> weights);
+
+	// Returns SIZE_MAX once every remaining weight is 0.
+	size_t draw(rng_t& rng) const;
+	// Sets the weight of [index] to 0, so that it is never drawn again.
+	void remove(size_t index);
+	double total() const { return sum; }
+
+private:
+	struct level_t
+	{
+		// The items on the first level, and the group totals of the
+		// level below on the others
+		std::vector<double> weights;
+		std::vector<alias_table_t> groups;
+	};
+
+	// From the items up. The last one has a single group.
+	std::vector<level_t> levels;
+	double sum = 0.0;
+	alias_table_t::scratch_t scratch;
+
+	// Rebuilds group [g] of [level]. Returns its total.
+	double build_group(level_t& level, size_t g);
+};
@@ -0,0 +1,60 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Priority job scheduler
+  */
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include "scheduler.h"
+#include "thread_pool.h"
+
+void job_scheduler_t::add(unsigned priority, job_func_t job)
+{
+	queue.push_back({ priority, std::move(job) });
+}
+
+void job_scheduler_t::milestone(unsigned priority, std::function<void()> fn)
+{
+	milestones.push_back({ priority, std::move(fn) });
+}
+
+void job_scheduler_t::run(unsigned jobs)
+{
+	std::vector<job_t> batch = std::move(queue);
+	queue.clear();
+	std::vector<milestone_t> pending = std::move(milestones);
+	milestones.clear();
+
+	std::stable_sort(batch.begin(), batch.end(), [](const job_t& a, const job_t& b) {
+		return a.priority < b.priority;
+	});
+
+	// Jobs left before each milestone
+	std::unique_ptr<std::atomic<size_t>[]> left(new std::atomic<size_t>[pending.size()]);
+	for (size_t m = 0; m < pending.size(); m++) {
+		size_t count = 0;
+		for (const job_t& job : batch) {
+			count += job.priority <= pending[m].priority;
+		}
+		left[m] = count;
+		if (count == 0) {
+			pending[m].fn();
+		}
+	}
+
+	// parallel_for() hands out indices in order, so jobs start in
+	// priority order.
+	parallel_for(batch.size(), jobs, [&](size_t i, unsigned worker) {
+		batch[i].fn(worker);
+		for (size_t m = 0; m < pending.size(); m++) {
+			if (batch[i].priority <= pending[m].priority && --left[m] == 0) {
+				pending[m].fn();
+			}
+		}
+	});
+}
@@ -0,0 +1,51 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Priority job scheduler
+  */
+
+#pragma once
+
+#include <functional>
+#include <stddef.h>
+#include <vector>
+
+// Runs a batch of jobs on a bounded number of threads. Jobs start in order
+// of priority, lowest value first, and in the order they were added within
+// the same priority. Milestones fire as soon as every job up to some
+// priority has finished, while the rest keeps running.
+class job_scheduler_t
+{
+public:
+	typedef std::function<void(unsigned worker)> job_func_t;
+
+	void add(unsigned priority, job_func_t job);
+	// [fn] is called once, by the thread that finishes the last job with a
+	// priority of at most [priority], or by run() right away if there is
+	// no such job.
+	void milestone(unsigned priority, std::function<void()> fn);
+
+	// Runs every job added so far on up to [jobs] threads, and returns
+	// once they have all finished.
+	void run(unsigned jobs);
+
+	size_t size() const { return queue.size(); }
+
+private:
+	struct job_t
+	{
+		unsigned priority;
+		job_func_t fn;
+	};
+	struct milestone_t
+	{
+		unsigned priority;
+		std::function<void()> fn;
+	};
+
+	std::vector<job_t> queue;
+	std::vector<milestone_t> milestones;
+};
@@ -0,0 +1,47 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Patch selection stack
+  */
+
+#include "sel_stack.h"
+
+// Can't be atoms, since those are dense
+static const uint64_t SEL_ANY = 0xfffffffeull;
+static const uint64_t SEL_WILDCARD = 0xfffffffdull;
+
+static uint64_t sel_key(uint64_t repo, uint32_t patch)
+{
+	return repo << 32 | patch;
+}
+
+void sel_stack_t::push(const char* repo_id, const char* patch_id)
+{
+	uint32_t repo = repo_id ? atoms.intern(repo_id) : CATALOG_NONE;
+	uint32_t patch = atoms.intern(patch_id);
+	entries.emplace_back(repo, patch);
+	members.insert(sel_key(repo_id ? repo : SEL_WILDCARD, patch), 1);
+	members.insert(sel_key(SEL_ANY, patch), 1);
+}
+
+bool sel_stack_t::contains(const char* repo_id, const char* patch_id) const
+{
+	uint32_t patch = atoms.find(patch_id);
+	if (patch == CATALOG_NONE) {
+		return false;
+	}
+	if (!repo_id) {
+		return members.find(sel_key(SEL_ANY, patch)) != CATALOG_NONE;
+	}
+	uint32_t repo = atoms.find(repo_id);
+	return (repo != CATALOG_NONE && members.find(sel_key(repo, patch)) != CATALOG_NONE)
+		|| members.find(sel_key(SEL_WILDCARD, patch)) != CATALOG_NONE;
+}
+
+const char* sel_stack_t::repo_id(size_t i) const
+{
+	return entries[i].first != CATALOG_NONE ? atoms.c_str(entries[i].first) : nullptr;
+}
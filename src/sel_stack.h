@@ -0,0 +1,41 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Patch selection stack
+  */
+
+#pragma once
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "catalog.h"
+
+// The patches selected so far, in the order they were added, with O(1)
+// membership tests. Matching follows sel_match() from thcrap_configure:
+// a patch ID without a repo matches that patch from any repo, and so does
+// an entry without a repo.
+class sel_stack_t
+{
+public:
+	// [repo_id] can be nullptr.
+	void push(const char* repo_id, const char* patch_id);
+	bool contains(const char* repo_id, const char* patch_id) const;
+
+	size_t size() const { return entries.size(); }
+	// nullptr if the entry was pushed without a repo. Only valid until
+	// the next push().
+	const char* repo_id(size_t i) const;
+	const char* patch_id(size_t i) const { return atoms.c_str(entries[i].second); }
+
+private:
+	string_interner_t atoms;
+	// (repo atom or CATALOG_NONE, patch atom)
+	std::vector<std::pair<uint32_t, uint32_t>> entries;
+	// Keyed on (repo atom, patch atom), plus (ANY, patch atom) for every
+	// entry and (WILDCARD, patch atom) for entries without a repo
+	pair_table_t members;
+};
@@ -0,0 +1,25 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * SHA-256
+  */
+
+#pragma once
+
+#include <array>
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+typedef std::array<uint8_t, 32> sha256_t;
+
+// For telling files apart where a CRC32 could collide
+sha256_t sha256_calc(const void* data, size_t size);
+
+// Lowercase hex, 64 characters
+std::string sha256_hex(const sha256_t& hash);
+// Returns false if [hex] isn't 64 hex digits.
+bool sha256_parse(const char* hex, sha256_t& hash);
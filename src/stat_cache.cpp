@@ -0,0 +1,118 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Cache of local file CRC32s
+  */
+
+#include <filesystem>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "stat_cache.h"
+
+namespace fs = std::filesystem;
+
+// Text file: a "<generation>" line, then one
+// "<crc32> <size> <mtime> <used> <path>" line per entry, all numbers in
+// hex. The path goes last, since it can contain spaces.
+bool stat_cache_t::load(const char* fn)
+{
+	std::scoped_lock lock(mutex);
+	entries.clear();
+	generation = 0;
+
+	FILE* file = fopen(fn, "r");
+	if (!file) {
+		return false;
+	}
+	bool ok = fscanf(file, "%" SCNx64 "\n", &generation) == 1;
+	char line[4096];
+	while (ok && fgets(line, sizeof(line), file)) {
+		size_t len = strlen(line);
+		if (len == 0 || line[len - 1] != '\n') {
+			// Longer than any path thcrap can use, skip the rest of it
+			int c;
+			while ((c = fgetc(file)) != '\n' && c != EOF);
+			continue;
+		}
+		line[--len] = '\0';
+
+		entry_t entry;
+		int path_start = 0;
+		if (sscanf(line, "%" SCNx32 " %" SCNx64 " %" SCNx64 " %" SCNx64 " %n", &entry.crc32, &entry.size, &entry.mtime, &entry.used, &path_start) == 4 && path_start > 0 && line[path_start]) {
+			entries[line + path_start] = entry;
+		}
+	}
+	fclose(file);
+	return ok;
+}
+
+bool stat_cache_t::save(const char* fn)
+{
+	std::scoped_lock lock(mutex);
+	generation++;
+
+	std::string tmp = fn;
+	tmp += ".tmp";
+	FILE* file = fopen(tmp.c_str(), "w");
+	if (!file) {
+		return false;
+	}
+	fprintf(file, "%" PRIx64 "\n", generation);
+	for (auto it = entries.begin(); it != entries.end();) {
+		const entry_t& entry = it->second;
+		if (entry.used + max_age < generation) {
+			it = entries.erase(it);
+			continue;
+		}
+		fprintf(file, "%08" PRIx32 " %" PRIx64 " %" PRIx64 " %" PRIx64 " %s\n", entry.crc32, entry.size, entry.mtime, entry.used, it->first.c_str());
+		++it;
+	}
+	bool ok = fclose(file) == 0;
+	// Replaces [fn] atomically, unlike remove() + rename(), which leaves no
+	// cache at all if the process dies in between.
+	std::error_code ec;
+	if (ok) {
+		fs::rename(tmp, fn, ec);
+	}
+	if (!ok || ec) {
+		fs::remove(tmp, ec);
+		return false;
+	}
+	return true;
+}
+
+bool stat_cache_t::lookup(std::string_view path, uint64_t size, uint64_t mtime, uint32_t& crc32)
+{
+	std::scoped_lock lock(mutex);
+	auto it = entries.find(std::string(path));
+	if (it == entries.end() || it->second.size != size || it->second.mtime != mtime) {
+		miss_count++;
+		return false;
+	}
+	it->second.used = generation;
+	crc32 = it->second.crc32;
+	hit_count++;
+	return true;
+}
+
+void stat_cache_t::store(std::string_view path, uint64_t size, uint64_t mtime, uint32_t crc32)
+{
+	std::scoped_lock lock(mutex);
+	entries[std::string(path)] = { size, mtime, crc32, generation };
+}
+
+size_t stat_cache_t::hits() const
+{
+	std::scoped_lock lock(mutex);
+	return hit_count;
+}
+
+size_t stat_cache_t::misses() const
+{
+	std::scoped_lock lock(mutex);
+	return miss_count;
+}
@@ -0,0 +1,60 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Cache of local file CRC32s
+  */
+
+#pragma once
+
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#define STAT_CACHE_FN "roulette/stat_cache.txt"
+
+// Remembers the CRC32 of local files together with their size and
+// modification time when they were hashed, so that a file whose size and
+// time haven't changed since doesn't need to be read again. Safe to use
+// from several threads at once.
+class stat_cache_t
+{
+public:
+	// Entries that no roll has looked at for this many saves are dropped.
+	explicit stat_cache_t(unsigned max_age = 32) : max_age(max_age) {}
+	stat_cache_t(const stat_cache_t&) = delete;
+	stat_cache_t& operator=(const stat_cache_t&) = delete;
+
+	bool load(const char* fn);
+	bool save(const char* fn);
+
+	// Returns true and sets [crc32] if [path] was hashed with exactly this
+	// size and modification time.
+	bool lookup(std::string_view path, uint64_t size, uint64_t mtime, uint32_t& crc32);
+	void store(std::string_view path, uint64_t size, uint64_t mtime, uint32_t crc32);
+
+	size_t hits() const;
+	size_t misses() const;
+
+private:
+	struct entry_t
+	{
+		uint64_t size;
+		uint64_t mtime;
+		uint32_t crc32;
+		// Value of [generation] when this entry was last used
+		uint64_t used;
+	};
+
+	unsigned max_age;
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, entry_t> entries;
+	// Incremented on every save
+	uint64_t generation = 0;
+	size_t hit_count = 0;
+	size_t miss_count = 0;
+};
@@ -0,0 +1,48 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Bounded worker pool
+  */
+
+#include "thread_pool.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+void parallel_for(size_t count, unsigned jobs, const std::function<void(size_t index, unsigned worker)>& fn)
+{
+	if (jobs == 0) {
+		jobs = 1;
+	}
+	if (jobs > count) {
+		jobs = (unsigned)count;
+	}
+	if (jobs <= 1) {
+		for (size_t i = 0; i < count; i++) {
+			fn(i, 0);
+		}
+		return;
+	}
+
+	// Workers pull indices from a shared counter instead of getting fixed
+	// slices, so a few slow servers don't leave the other threads idle.
+	std::atomic<size_t> next = 0;
+	auto worker_main = [&](unsigned worker) {
+		for (size_t i = next++; i < count; i = next++) {
+			fn(i, worker);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(jobs - 1);
+	for (unsigned w = 1; w < jobs; w++) {
+		threads.emplace_back(worker_main, w);
+	}
+	worker_main(0);
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+}
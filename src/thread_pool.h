@@ -0,0 +1,19 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Bounded worker pool
+  */
+
+#pragma once
+
+#include <functional>
+#include <stddef.h>
+
+// Calls [fn] once for every index in [0, count), using at most [jobs]
+// threads at once. [fn] also receives the index of the worker running it,
+// in [0, jobs), so callers can keep per-worker state without locking.
+// Returns once every call has finished.
+void parallel_for(size_t count, unsigned jobs, const std::function<void(size_t index, unsigned worker)>& fn);
@@ -0,0 +1,180 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Chrome trace-event recording
+  */
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <vector>
+#include "trace.h"
+
+std::atomic<bool> trace_recording = false;
+
+struct trace_event_t
+{
+	const char* name;
+	const char* category;
+	int64_t start;
+	int64_t duration;
+	std::string args;
+};
+
+// Every thread appends to its own buffer. The mutex is only ever contended
+// by trace_start() and trace_stop().
+struct trace_buffer_t
+{
+	std::mutex mutex;
+	uint32_t tid;
+	std::vector<trace_event_t> events;
+};
+
+static std::mutex buffers_mutex;
+// Kept after their thread has exited, until the trace is written
+static std::vector<std::shared_ptr<trace_buffer_t>> buffers;
+static std::atomic<int64_t> epoch = 0;
+
+static int64_t clock_ns()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static trace_buffer_t& thread_buffer()
+{
+	thread_local std::shared_ptr<trace_buffer_t> buffer = [] {
+		auto ret = std::make_shared<trace_buffer_t>();
+		std::lock_guard lock(buffers_mutex);
+		ret->tid = (uint32_t)buffers.size() + 1;
+		buffers.push_back(ret);
+		return ret;
+	}();
+	return *buffer;
+}
+
+static void append_escaped(std::string& out, std::string_view str)
+{
+	out += '"';
+	for (char c : str) {
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		}
+		else if ((uint8_t)c < 0x20) {
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", (uint8_t)c);
+			out += buf;
+		}
+		else {
+			out += c;
+		}
+	}
+	out += '"';
+}
+
+// Microseconds with nanosecond precision, which is what "ts" and "dur" are
+static void append_us(std::string& out, int64_t ns)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%lld.%03d", (long long)(ns / 1000), (int)(ns % 1000));
+	out += buf;
+}
+
+void trace_start()
+{
+	{
+		std::lock_guard lock(buffers_mutex);
+		for (const auto& buffer : buffers) {
+			std::lock_guard buffer_lock(buffer->mutex);
+			buffer->events.clear();
+		}
+	}
+	epoch = clock_ns();
+	trace_recording = true;
+}
+
+int64_t trace_now()
+{
+	return clock_ns() - epoch.load(std::memory_order_relaxed);
+}
+
+std::string trace_stop()
+{
+	trace_recording = false;
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	std::lock_guard lock(buffers_mutex);
+	for (const auto& buffer : buffers) {
+		std::lock_guard buffer_lock(buffer->mutex);
+		for (const trace_event_t& event : buffer->events) {
+			if (!first) {
+				out += ",\n";
+			}
+			first = false;
+			out += "{\"ph\":\"X\",\"pid\":1,\"tid\":";
+			out += std::to_string(buffer->tid);
+			out += ",\"name\":";
+			append_escaped(out, event.name);
+			out += ",\"cat\":";
+			append_escaped(out, event.category);
+			out += ",\"ts\":";
+			append_us(out, event.start);
+			out += ",\"dur\":";
+			append_us(out, event.duration);
+			if (!event.args.empty()) {
+				out += ",\"args\":{";
+				out += event.args;
+				out += '}';
+			}
+			out += '}';
+		}
+		buffer->events.clear();
+	}
+	out += "\n]}\n";
+	return out;
+}
+
+void trace_span_t::arg(const char* key, std::string_view value)
+{
+	if (start < 0) {
+		return;
+	}
+	if (!args.empty()) {
+		args += ',';
+	}
+	append_escaped(args, key);
+	args += ':';
+	append_escaped(args, value);
+}
+
+void trace_span_t::arg(const char* key, int64_t value)
+{
+	if (start < 0) {
+		return;
+	}
+	if (!args.empty()) {
+		args += ',';
+	}
+	append_escaped(args, key);
+	args += ':';
+	args += std::to_string(value);
+}
+
+void trace_span_t::finish()
+{
+	// Recording was stopped, or restarted, while the span was open
+	if (!trace_enabled()) {
+		return;
+	}
+	int64_t end = trace_now();
+	if (end < start) {
+		return;
+	}
+	trace_buffer_t& buffer = thread_buffer();
+	std::lock_guard lock(buffer.mutex);
+	buffer.events.push_back({ name, category, start, end - start, std::move(args) });
+}
@@ -0,0 +1,70 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Chrome trace-event recording
+  */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+// Records timed spans from any thread, and turns them into a trace-event
+// JSON document that chrome://tracing and ui.perfetto.dev can open.
+// Until trace_start() is called, a span costs one relaxed atomic load.
+
+extern std::atomic<bool> trace_recording;
+
+inline bool trace_enabled()
+{
+	return trace_recording.load(std::memory_order_relaxed);
+}
+
+// Starts recording. Anything recorded before is discarded.
+void trace_start();
+
+// Stops recording, and returns everything that was recorded. Spans that
+// are still open at this point are left out.
+std::string trace_stop();
+
+// Nanoseconds since trace_start()
+int64_t trace_now();
+
+// Records the time from its construction to its destruction as one
+// complete event on the calling thread.
+class trace_span_t
+{
+public:
+	// [name] and [category] must outlive the trace, so they're usually
+	// string literals.
+	explicit trace_span_t(const char* name, const char* category = "roll")
+		: name(name), category(category), start(trace_enabled() ? trace_now() : -1) {}
+	~trace_span_t()
+	{
+		if (start >= 0) {
+			finish();
+		}
+	}
+	trace_span_t(const trace_span_t&) = delete;
+	trace_span_t& operator=(const trace_span_t&) = delete;
+
+	// Shown with the event. Does nothing if the span isn't recorded.
+	void arg(const char* key, std::string_view value);
+	void arg(const char* key, int64_t value);
+
+	bool recording() const { return start >= 0; }
+
+private:
+	const char* name;
+	const char* category;
+	int64_t start;
+	// Already formatted as the members of a JSON object
+	std::string args;
+
+	void finish();
+};
@@ -0,0 +1,69 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Pluggable network access
+  */
+
+#include "trace.h"
+#include "transport.h"
+
+static transport_t* current_transport = nullptr;
+
+void transport_use(transport_t* transport)
+{
+	current_transport = transport;
+}
+
+transport_t* transport_current()
+{
+	return current_transport;
+}
+
+static const char* http_status_name(HttpStatus status)
+{
+	switch (status) {
+	case HttpOk:
+		return "ok";
+	case HttpCancelled:
+		return "cancelled";
+	case HttpClientError:
+		return "client error";
+	case HttpServerError:
+		return "server error";
+	default:
+		return "system error";
+	}
+}
+
+HttpStatus download_stream(const char* url, const download_chunk_func_t& on_chunk)
+{
+	if (!current_transport) {
+		return HttpSystemError;
+	}
+	if (!trace_enabled()) {
+		return current_transport->stream(url, on_chunk);
+	}
+
+	trace_span_t span("download", "net");
+	int64_t bytes = 0;
+	HttpStatus status = current_transport->stream(url, [&](const uint8_t* data, size_t size) {
+		bytes += size;
+		return on_chunk(data, size);
+	});
+	span.arg("url", url);
+	span.arg("bytes", bytes);
+	span.arg("status", http_status_name(status));
+	return status;
+}
+
+HttpStatus download_to_memory(const char* url, std::vector<uint8_t>& out)
+{
+	out.clear();
+	return download_stream(url, [&out](const uint8_t* data, size_t size) {
+		out.insert(out.end(), data, data + size);
+		return true;
+	});
+}
@@ -0,0 +1,73 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Pluggable network access
+  */
+
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+// Copied from thcrap_wrapper/src/install_modules.c to fix linker error
+
+// From thcrap_update/src/http_status.h
+// Slightly modified since this is C
+typedef enum HttpStatus {
+	// 200 - success
+	HttpOk,
+	// Download cancelled by the progress callback, or another client
+	// declared the server as dead
+	HttpCancelled,
+	// 3XX and 4XX - file not found, not accessible, moved, etc.
+	HttpClientError,
+	// 5XX errors - server errors, further requests are likely to fail.
+	// Also covers weird error codes like 1XX and 2XX which we shouldn't see.
+	HttpServerError,
+	// Error returned by the download library or by the write callback
+	HttpSystemError,
+	// Error encountered before loading thcrap_update.dll
+	HttpLibLoadError
+} HttpStatus;
+
+// Called with every chunk of a response body as it arrives.
+// Return false to cancel the download.
+typedef std::function<bool(const uint8_t* data, size_t size)> download_chunk_func_t;
+
+// Where every download of roulette comes from
+class transport_t
+{
+public:
+	virtual ~transport_t() = default;
+
+	// Streams the body of [url] into [on_chunk]. Returns HttpCancelled if
+	// [on_chunk] cancelled the download. Must be safe to call from several
+	// threads at once.
+	virtual HttpStatus stream(const char* url, const download_chunk_func_t& on_chunk) = 0;
+};
+
+// Routes download_stream() and download_to_memory() through [transport],
+// which must outlive every download. Not thread-safe; call it before
+// starting any download.
+void transport_use(transport_t* transport);
+transport_t* transport_current();
+
+// The real network, streamed through libcurl. Defined in
+// transport_curl.cpp, so only available in the Windows front end.
+// Returns NULL if libcurl couldn't be initialized.
+transport_t* curl_transport();
+
+// Streams the body of [url] into [on_chunk] through the current
+// transport, without touching the disk.
+// Returns HttpCancelled if [on_chunk] cancelled the download.
+// Safe to call from several threads at once.
+HttpStatus download_stream(const char* url, const download_chunk_func_t& on_chunk);
+
+// Downloads [url] into [out] without touching the disk.
+// [out] is only meaningful if HttpOk is returned.
+// Safe to call from several threads at once.
+HttpStatus download_to_memory(const char* url, std::vector<uint8_t>& out);
@@ -0,0 +1,93 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Transport over the real network, using libcurl, the same library that
+  * thcrap_update downloads with
+  */
+
+#include <curl/curl.h>
+#include "transport.h"
+
+class curl_transport_t : public transport_t
+{
+public:
+	HttpStatus stream(const char* url, const download_chunk_func_t& on_chunk) override;
+};
+
+struct curl_sink_t
+{
+	const download_chunk_func_t& on_chunk;
+	bool cancelled = false;
+};
+
+static size_t curl_write(char* data, size_t size, size_t nmemb, void* userdata)
+{
+	curl_sink_t& sink = *(curl_sink_t*)userdata;
+	size_t bytes = size * nmemb;
+	if (bytes && !sink.on_chunk((const uint8_t*)data, bytes)) {
+		sink.cancelled = true;
+		// Anything other than [bytes] makes curl abort the transfer
+		return 0;
+	}
+	return bytes;
+}
+
+// One handle per thread, so that connections to the same server are
+// reused across downloads.
+static CURL* curl_thread_handle()
+{
+	struct handle_t
+	{
+		CURL* curl = curl_easy_init();
+		~handle_t() { curl_easy_cleanup(curl); }
+	};
+	thread_local handle_t handle;
+	return handle.curl;
+}
+
+HttpStatus curl_transport_t::stream(const char* url, const download_chunk_func_t& on_chunk)
+{
+	CURL* curl = curl_thread_handle();
+	if (!curl) {
+		return HttpSystemError;
+	}
+	curl_easy_reset(curl);
+	curl_sink_t sink = { on_chunk };
+	curl_easy_setopt(curl, CURLOPT_URL, url);
+	curl_easy_setopt(curl, CURLOPT_USERAGENT, "thcrap_roulette");
+	curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	// Error pages never reach [on_chunk]
+	curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
+
+	CURLcode res = curl_easy_perform(curl);
+	if (sink.cancelled) {
+		return HttpCancelled;
+	}
+	if (res == CURLE_OK) {
+		return HttpOk;
+	}
+	if (res == CURLE_HTTP_RETURNED_ERROR) {
+		long code = 0;
+		curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &code);
+		return code >= 300 && code < 500 ? HttpClientError : HttpServerError;
+	}
+	return HttpSystemError;
+}
+
+transport_t* curl_transport()
+{
+	// Function-local statics are initialized once even with several
+	// threads racing for them.
+	static bool initialized = curl_global_init(CURL_GLOBAL_DEFAULT) == CURLE_OK;
+	if (!initialized) {
+		return nullptr;
+	}
+	static curl_transport_t transport;
+	return &transport;
+}
@@ -0,0 +1,115 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Transport reading from a local copy of the servers
+  */
+
+#include <filesystem>
+#include <fstream>
+#include <string.h>
+#include "transport_mirror.h"
+
+static const char FILE_SCHEME[] = "file://";
+
+static int hex_digit(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// Decodes %XX escapes, and drops the query string and fragment.
+static std::string url_decode_path(const char* path)
+{
+	std::string ret;
+	for (const char* p = path; *p && *p != '?' && *p != '#'; p++) {
+		int hi, lo;
+		if (p[0] == '%' && (hi = hex_digit(p[1])) >= 0 && (lo = hex_digit(p[2])) >= 0) {
+			ret += (char)(hi << 4 | lo);
+			p += 2;
+		}
+		else {
+			ret += *p;
+		}
+	}
+	return ret;
+}
+
+// file:///C:/mirror and file:///srv/mirror both have an extra slash in
+// front of the path that only belongs there on POSIX systems.
+static std::string file_url_to_path(const char* url)
+{
+	std::string path = url_decode_path(url + strlen(FILE_SCHEME));
+	if (path.size() >= 3 && path[0] == '/' && path[2] == ':') {
+		path.erase(0, 1);
+	}
+	return path;
+}
+
+mirror_transport_t::mirror_transport_t(std::string root)
+	: root(root.compare(0, strlen(FILE_SCHEME), FILE_SCHEME) == 0 ? file_url_to_path(root.c_str()) : std::move(root))
+{
+	while (!this->root.empty() && (this->root.back() == '/' || this->root.back() == '\\')) {
+		this->root.pop_back();
+	}
+}
+
+std::string mirror_transport_t::path_for(const char* url) const
+{
+	if (strncmp(url, FILE_SCHEME, strlen(FILE_SCHEME)) == 0) {
+		return file_url_to_path(url);
+	}
+
+	const char* host = strstr(url, "://");
+	host = host ? host + 3 : url;
+	std::string rel = url_decode_path(host);
+
+	// Every segment must stay inside the mirror
+	size_t start = 0;
+	while (start <= rel.size()) {
+		size_t end = rel.find_first_of("/\\", start);
+		if (end == std::string::npos) {
+			end = rel.size();
+		}
+		if (rel.compare(start, end - start, "..") == 0) {
+			return {};
+		}
+		start = end + 1;
+	}
+	return root + "/" + rel;
+}
+
+HttpStatus mirror_transport_t::stream(const char* url, const download_chunk_func_t& on_chunk)
+{
+	std::string path = path_for(url);
+	if (path.empty()) {
+		return HttpClientError;
+	}
+	// u8path() so that non-ASCII file names also work on Windows
+	std::filesystem::path fs_path = std::filesystem::u8path(path);
+	std::error_code ec;
+	if (!std::filesystem::is_regular_file(fs_path, ec)) {
+		return HttpClientError;
+	}
+	std::ifstream in(fs_path, std::ios::binary);
+	if (!in) {
+		return HttpClientError;
+	}
+
+	uint8_t chunk[16384];
+	for (;;) {
+		in.read((char*)chunk, sizeof(chunk));
+		size_t read = (size_t)in.gcount();
+		if (read == 0) {
+			break;
+		}
+		if (!on_chunk(chunk, read)) {
+			return HttpCancelled;
+		}
+	}
+	return in.bad() ? HttpSystemError : HttpOk;
+}
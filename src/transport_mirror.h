@@ -0,0 +1,34 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Transport reading from a local copy of the servers
+  */
+
+#pragma once
+
+#include <string>
+#include "transport.h"
+
+// Serves every URL from a local directory laid out like the servers, so
+// that https://srv.thpatch.net/lang_en/patch.js is read from
+// <root>/srv.thpatch.net/lang_en/patch.js. file:// URLs are read from
+// their own path instead. Missing files are reported as HttpClientError,
+// just like a 404.
+class mirror_transport_t : public transport_t
+{
+public:
+	// [root] can be a directory or a file:// URL.
+	explicit mirror_transport_t(std::string root);
+
+	HttpStatus stream(const char* url, const download_chunk_func_t& on_chunk) override;
+
+	// Local path that [url] is read from, or an empty string if [url]
+	// would escape the mirror.
+	std::string path_for(const char* url) const;
+
+private:
+	std::string root;
+};
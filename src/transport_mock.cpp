@@ -0,0 +1,112 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * In-process transport with simulated latency, bandwidth and errors
+  */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "sampler.h"
+#include "trace.h"
+#include "transport_mock.h"
+
+static const size_t MOCK_CHUNK_SIZE = 16384;
+
+static uint64_t hash_url(const char* url)
+{
+	// FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ull;
+	for (const char* p = url; *p; p++) {
+		hash ^= (uint8_t)*p;
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+mock_transport_t::mock_transport_t(const mock_transport_options_t& options, transport_t* backing)
+	: options(options), backing(backing)
+{
+}
+
+void mock_transport_t::add(std::string url, std::vector<uint8_t> body)
+{
+	bodies[std::move(url)] = std::move(body);
+}
+
+void mock_transport_t::add(std::string url, std::string_view body)
+{
+	bodies[std::move(url)] = std::vector<uint8_t>(body.begin(), body.end());
+}
+
+HttpStatus mock_transport_t::stream(const char* url, const download_chunk_func_t& on_chunk)
+{
+	using clock = std::chrono::steady_clock;
+	requests++;
+
+	uint32_t attempt;
+	{
+		std::lock_guard lock(attempts_mutex);
+		attempt = attempts[url]++;
+	}
+	rng_t rng(options.seed ^ hash_url(url) ^ (attempt * 0x9e3779b97f4a7c15ull));
+
+	double delay_ms = options.latency_ms;
+	if (options.jitter_ms > 0.0) {
+		delay_ms -= options.jitter_ms * std::log(1.0 - rng.unit());
+	}
+	bool fail = options.error_rate > 0.0 && rng.unit() < options.error_rate;
+	if (delay_ms > 0.0) {
+		trace_span_t span("latency", "net");
+		std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(delay_ms));
+	}
+	if (fail) {
+		failed++;
+		return HttpServerError;
+	}
+
+	// Sleeping until the time the data would have arrived by, rather than
+	// for each chunk, keeps the oversleeping of every chunk from adding up.
+	clock::time_point start = clock::now();
+	uint64_t sent = 0;
+	auto send = [&](const uint8_t* data, size_t size) {
+		if (options.bandwidth > 0.0) {
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<clock::duration>(
+				std::chrono::duration<double>((sent + size) / options.bandwidth)
+			));
+		}
+		sent += size;
+		bytes += size;
+		return on_chunk(data, size);
+	};
+
+	auto body = bodies.find(url);
+	if (body == bodies.end()) {
+		if (!backing) {
+			failed++;
+			return HttpClientError;
+		}
+		HttpStatus ret = backing->stream(url, send);
+		if (ret != HttpOk && ret != HttpCancelled) {
+			failed++;
+		}
+		return ret;
+	}
+
+	const std::vector<uint8_t>& data = body->second;
+	for (size_t pos = 0; pos < data.size(); pos += MOCK_CHUNK_SIZE) {
+		if (!send(data.data() + pos, std::min(MOCK_CHUNK_SIZE, data.size() - pos))) {
+			return HttpCancelled;
+		}
+	}
+	return HttpOk;
+}
+
+mock_transport_t::stats_t mock_transport_t::stats() const
+{
+	return { requests, failed, bytes };
+}
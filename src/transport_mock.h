@@ -0,0 +1,72 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * In-process transport with simulated latency, bandwidth and errors
+  */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "transport.h"
+
+struct mock_transport_options_t
+{
+	// Delay before the first byte of every request
+	double latency_ms = 0.0;
+	// Mean of an exponentially distributed delay added on top of
+	// [latency_ms], which gives the latency a long tail
+	double jitter_ms = 0.0;
+	// Of every single request, in bytes per second. 0 is unlimited.
+	double bandwidth = 0.0;
+	// Fraction of requests that fail with HttpServerError before sending
+	// anything
+	double error_rate = 0.0;
+	uint64_t seed = 0;
+};
+
+// Serves bodies from memory, or from another transport, as if they came
+// over a network with the given characteristics. The delays and errors
+// only depend on the seed, the URL, and how often that URL was requested
+// before, so runs with the same requests behave the same regardless of
+// how they are spread over threads.
+class mock_transport_t : public transport_t
+{
+public:
+	struct stats_t
+	{
+		size_t requests;
+		size_t failed;
+		uint64_t bytes;
+	};
+
+	// URLs that weren't add()ed are forwarded to [backing], or reported as
+	// HttpClientError if there is none.
+	explicit mock_transport_t(const mock_transport_options_t& options, transport_t* backing = nullptr);
+
+	// Not thread-safe with stream().
+	void add(std::string url, std::vector<uint8_t> body);
+	void add(std::string url, std::string_view body);
+
+	HttpStatus stream(const char* url, const download_chunk_func_t& on_chunk) override;
+
+	stats_t stats() const;
+
+private:
+	mock_transport_options_t options;
+	transport_t* backing;
+	std::unordered_map<std::string, std::vector<uint8_t>> bodies;
+
+	std::mutex attempts_mutex;
+	std::unordered_map<std::string, uint32_t> attempts;
+
+	std::atomic<size_t> requests = 0;
+	std::atomic<size_t> failed = 0;
+	std::atomic<uint64_t> bytes = 0;
+};
@@ -0,0 +1,102 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for the bump allocator
+  */
+
+#include <stdint.h>
+#include <string.h>
+#include "arena.h"
+#include "test.h"
+
+static void test_counts()
+{
+	arena_t arena(1024);
+	arena.alloc(10);
+	arena.alloc(20, 1);
+	arena.copy("abc");
+	CHECK(arena.stats().allocations == 3);
+	CHECK(arena.stats().bytes == 34);
+
+	// Interned strings are only allocated the first time
+	const char* a = arena.intern("th06");
+	const char* b = arena.intern(std::string_view("th06/msg", 4));
+	CHECK(a == b);
+	CHECK(strcmp(a, "th06") == 0);
+	CHECK(arena.intern("th07") != a);
+	CHECK(arena.stats().allocations == 5);
+	CHECK(arena.stats().bytes == 44);
+}
+
+static void test_alignment()
+{
+	arena_t arena(1024);
+	for (size_t align : { 1, 2, 8, 16, 64 }) {
+		arena.alloc(3, 1);
+		CHECK((uintptr_t)arena.alloc(5, align) % align == 0);
+	}
+	arena.alloc(1, 1);
+	CHECK((uintptr_t)arena.alloc(1) % alignof(max_align_t) == 0);
+	// Oversized ones, too
+	CHECK((uintptr_t)arena.alloc(1000, 64) % 64 == 0);
+}
+
+static void test_blocks()
+{
+	arena_t arena(1024);
+	char* first = (char*)arena.alloc(200, 1);
+	arena.alloc(200, 1);
+	arena.alloc(200, 1);
+	arena.alloc(200, 1);
+	CHECK(arena.stats().peak_bytes == 1024);
+
+	// Doesn't fit into the 224 bytes that are left, but is big enough to
+	// get a block of its own, so the next small one still goes into the
+	// first block
+	char* big = (char*)arena.alloc(300, 1);
+	CHECK(big != nullptr);
+	CHECK(arena.stats().peak_bytes == 1024 + 301);
+	char* next = (char*)arena.alloc(200, 1);
+	CHECK(next == first + 800);
+	memset(big, 0xff, 300);
+	memset(first, 0, 1000);
+
+	// A small one that doesn't fit starts a new block
+	arena.alloc(200, 1);
+	CHECK(arena.stats().peak_bytes == 2 * 1024 + 301);
+	CHECK(arena.stats().allocations == 7);
+}
+
+static void test_release()
+{
+	arena_t arena(1024);
+	arena.alloc(100);
+	arena.alloc(5000);
+	arena.intern("th06");
+	CHECK(arena.stats().peak_bytes > 5000);
+
+	// Everything counts from the release on
+	arena.release();
+	CHECK(arena.stats().allocations == 0);
+	CHECK(arena.stats().bytes == 0);
+	CHECK(arena.stats().peak_bytes == 0);
+	arena.alloc(100);
+	CHECK(arena.stats().allocations == 1);
+	CHECK(arena.stats().peak_bytes == 1024);
+
+	// The interned strings are gone, too
+	arena.intern("th06");
+	CHECK(arena.stats().allocations == 2);
+}
+
+int main()
+{
+	RUN_TEST(test_counts);
+	RUN_TEST(test_alignment);
+	RUN_TEST(test_blocks);
+	RUN_TEST(test_release);
+	return TEST_RESULT();
+}
@@ -0,0 +1,64 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for reading blacklist.json
+  */
+
+#include <string.h>
+#include "blacklist.h"
+#include "test.h"
+
+static bool parse(const char* doc, exclusion_set_t& repo_exclude, exclusion_set_t& patch_exclude, roll_weights_t& weights)
+{
+	return blacklist_parse(doc, strlen(doc), repo_exclude, patch_exclude, weights);
+}
+
+static void test_sections()
+{
+	exclusion_set_t repo_exclude;
+	exclusion_set_t patch_exclude;
+	roll_weights_t weights;
+	CHECK(parse(
+		"{"
+		"  \"repo_exclude\": [\"spam\", \"test_*\", 3],"
+		"  \"patch_exclude\": [\"debug_counters\"],"
+		"  \"repo_weights\": { \"thpatch\": 2.5, \"nmlgc\": -1, \"odd\": \"x\" },"
+		"  \"patch_weights\": { \"thpatch/lang_en\": 0 },"
+		"  \"unknown\": { \"nested\": [\"ignored\"] }"
+		"}", repo_exclude, patch_exclude, weights));
+	CHECK(repo_exclude.contains("spam"));
+	CHECK(repo_exclude.contains("test_repo"));
+	CHECK(patch_exclude.contains("debug_counters"));
+	CHECK(!patch_exclude.contains("ignored"));
+	CHECK(weights.repos.size() == 1 && weights.repos["thpatch"] == 2.5);
+	CHECK(weights.patches.size() == 1 && weights.patches.count("thpatch/lang_en") && weights.patches["thpatch/lang_en"] == 0.0);
+}
+
+static void test_wrong_types()
+{
+	exclusion_set_t repo_exclude;
+	exclusion_set_t patch_exclude;
+	roll_weights_t weights;
+	// Exclusions have to be arrays, and weights objects
+	CHECK(parse(
+		"{ \"repo_exclude\": { \"a\": \"b\" }, \"repo_weights\": [\"c\", 1], \"patch_exclude\": \"d\" }",
+		repo_exclude, patch_exclude, weights));
+	CHECK(repo_exclude.entries().empty());
+	CHECK(patch_exclude.entries().empty());
+	CHECK(weights.empty());
+
+	CHECK(!parse("[\"spam\"]", repo_exclude, patch_exclude, weights));
+	CHECK(!parse("{ \"repo_exclude\": [\"spam\"", repo_exclude, patch_exclude, weights));
+	// What came before the error is kept
+	CHECK(repo_exclude.contains("spam"));
+}
+
+int main()
+{
+	RUN_TEST(test_sections);
+	RUN_TEST(test_wrong_types);
+	return TEST_RESULT();
+}
@@ -0,0 +1,116 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for the content-addressed file store
+  */
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "blob_store.h"
+#include "crc32.h"
+#include "test.h"
+
+static std::string store_dir(const char* name)
+{
+	std::filesystem::path dir = std::filesystem::temp_directory_path() / name;
+	std::filesystem::remove_all(dir);
+	return dir.string();
+}
+
+static void put_str(blob_store_t& store, const std::string& fn, const std::string& str)
+{
+	store.put(fn, crc32_calc(str.data(), str.size()), str.data(), str.size());
+}
+
+static std::string get_str(blob_store_t& store, const std::string& fn, const std::string& expected)
+{
+	std::vector<uint8_t> out;
+	if (!store.get(fn, crc32_calc(expected.data(), expected.size()), out)) {
+		return "(miss)";
+	}
+	return std::string(out.begin(), out.end());
+}
+
+static void test_round_trip()
+{
+	std::string dir = store_dir("roulette_blob_store_test");
+	{
+		blob_store_t store(dir, 1 << 20);
+		put_str(store, "th06/msg.msg", "shared");
+		put_str(store, "th07/msg.msg", "shared");
+		put_str(store, "empty.txt", "");
+		// Stored once
+		CHECK(store.count() == 2);
+		CHECK(get_str(store, "th07/msg.msg", "shared") == "shared");
+		CHECK(get_str(store, "empty.txt", "") == "");
+		CHECK(store.save());
+	}
+	blob_store_t store(dir, 1 << 20);
+	store.load();
+	CHECK(store.count() == 2);
+	CHECK(store.size() == 6);
+	CHECK(get_str(store, "th06/msg.msg", "shared") == "shared");
+	CHECK(store.stats().hits == 1);
+	std::filesystem::remove_all(dir);
+}
+
+static void test_only_for_the_same_file()
+{
+	std::string dir = store_dir("roulette_blob_store_test");
+	blob_store_t store(dir, 1 << 20);
+	put_str(store, "th06/msg.msg", "shared");
+	// Same CRC32, but never stored as this file
+	CHECK(get_str(store, "th06/other.msg", "shared") == "(miss)");
+	// Another version of the file
+	CHECK(get_str(store, "th06/msg.msg", "changed") == "(miss)");
+	put_str(store, "th06/msg.msg", "changed");
+	CHECK(get_str(store, "th06/msg.msg", "changed") == "changed");
+	CHECK(get_str(store, "th06/msg.msg", "shared") == "shared");
+	CHECK(store.stats().misses == 2);
+	std::filesystem::remove_all(dir);
+}
+
+static void test_corrupted_blob()
+{
+	std::string dir = store_dir("roulette_blob_store_test");
+	blob_store_t store(dir, 1 << 20);
+	put_str(store, "file.txt", "abcd");
+	for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+		std::ofstream(entry.path(), std::ios::binary) << "abce";
+	}
+	CHECK(get_str(store, "file.txt", "abcd") == "(miss)");
+	std::filesystem::remove_all(dir);
+}
+
+static void test_eviction()
+{
+	std::string dir = store_dir("roulette_blob_store_test");
+	blob_store_t store(dir, 1 << 20);
+	put_str(store, "old", std::string(100, 'o'));
+	put_str(store, "new", std::string(100, 'n'));
+	CHECK(get_str(store, "old", std::string(100, 'o')) == std::string(100, 'o'));
+	put_str(store, "newer", std::string(100, 'm'));
+	// "new" is now the least recently used
+	CHECK(store.gc(200) == 100);
+	CHECK(store.count() == 2);
+	CHECK(get_str(store, "new", std::string(100, 'n')) == "(miss)");
+	CHECK(get_str(store, "old", std::string(100, 'o')) == std::string(100, 'o'));
+
+	// Files the index doesn't know about
+	std::ofstream(std::filesystem::path(dir) / "0badf00d-4", std::ios::binary) << "junk";
+	CHECK(store.gc(200) == 4);
+	std::filesystem::remove_all(dir);
+}
+
+int main()
+{
+	RUN_TEST(test_round_trip);
+	RUN_TEST(test_only_for_the_same_file);
+	RUN_TEST(test_corrupted_blob);
+	RUN_TEST(test_eviction);
+	return TEST_RESULT();
+}
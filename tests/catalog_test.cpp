@@ -0,0 +1,86 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for the repo/patch catalog
+  */
+
+#include <string>
+#include "catalog.h"
+#include "test.h"
+
+static void test_interner()
+{
+	string_interner_t atoms;
+	uint32_t a = atoms.intern("nmlgc");
+	uint32_t b = atoms.intern("thpatch");
+	CHECK(a != b);
+	CHECK(atoms.intern("nmlgc") == a);
+	CHECK(atoms.find("thpatch") == b);
+	CHECK(atoms.find("missing") == CATALOG_NONE);
+	CHECK(atoms.str(a) == "nmlgc");
+	CHECK(std::string(atoms.c_str(b)) == "thpatch");
+	CHECK(atoms.size() == 2);
+
+	// Enough to grow the table a few times
+	for (int i = 0; i < 10000; i++) {
+		atoms.intern("atom" + std::to_string(i));
+	}
+	CHECK(atoms.size() == 10002);
+	CHECK(atoms.find("atom1234") != CATALOG_NONE);
+	CHECK(atoms.str(atoms.find("atom9999")) == "atom9999");
+	CHECK(atoms.find("nmlgc") == a);
+}
+
+static void test_pair_table()
+{
+	pair_table_t table;
+	table.insert(1, 10);
+	table.insert(1, 20);
+	CHECK(table.find(1) == 10);
+	CHECK(table.find(2) == CATALOG_NONE);
+	for (uint64_t key = 0; key < 5000; key++) {
+		table.insert(key << 32 | 7, (uint32_t)key);
+	}
+	CHECK(table.find(4321ull << 32 | 7) == 4321);
+	CHECK(table.find(1) == 10);
+}
+
+static void test_catalog()
+{
+	catalog_t catalog;
+	uint32_t nmlgc = catalog.add_repo("nmlgc");
+	catalog.add_patch(nmlgc, "base_tsa");
+	catalog.add_patch(nmlgc, "lang_en");
+	uint32_t mirror = catalog.add_repo("mirror");
+	catalog.add_patch(mirror, "lang_en");
+	uint32_t dup = catalog.add_repo("nmlgc");
+	catalog.add_patch(dup, "other");
+	catalog.finish();
+
+	CHECK(catalog.repo_count() == 3);
+	CHECK(catalog.find_repo("nmlgc") == nmlgc);
+	CHECK(catalog.find_repo("mirror") == mirror);
+	CHECK(catalog.find_repo("missing") == CATALOG_NONE);
+	CHECK(catalog.find_patch(nmlgc, "lang_en") == 1);
+	CHECK(catalog.find_patch(mirror, "base_tsa") == CATALOG_NONE);
+	CHECK(catalog.find_patch(CATALOG_NONE, "lang_en") == CATALOG_NONE);
+
+	size_t count;
+	const uint32_t* owners = catalog.patch_owners("lang_en", count);
+	CHECK(owners && count == 2);
+	CHECK(owners && owners[0] == nmlgc && owners[1] == mirror);
+	CHECK(catalog.patch_owners("missing", count) == nullptr && count == 0);
+	// Repo IDs aren't patches
+	CHECK(catalog.patch_owners("nmlgc", count) == nullptr);
+}
+
+int main()
+{
+	RUN_TEST(test_interner);
+	RUN_TEST(test_pair_table);
+	RUN_TEST(test_catalog);
+	return TEST_RESULT();
+}
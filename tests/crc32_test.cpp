@@ -0,0 +1,65 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for CRC32
+  */
+
+#include <string.h>
+#include <vector>
+#include "crc32.h"
+#include "test.h"
+
+// Bit by bit, as the reference
+static uint32_t crc32_slow(const uint8_t* data, size_t size)
+{
+	uint32_t crc = 0xffffffff;
+	for (size_t i = 0; i < size; i++) {
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+		}
+	}
+	return ~crc;
+}
+
+static void test_known_values()
+{
+	CHECK(crc32_calc("", 0) == 0);
+	CHECK(crc32_calc("123456789", 9) == 0xcbf43926);
+}
+
+static void test_against_reference()
+{
+	std::vector<uint8_t> data(1000);
+	for (size_t i = 0; i < data.size(); i++) {
+		data[i] = (uint8_t)(i * 31 + 7);
+	}
+	// Every length and alignment around the 8-byte steps
+	for (size_t start = 0; start < 8; start++) {
+		for (size_t size = 0; size < 40; size++) {
+			CHECK(crc32_calc(data.data() + start, size) == crc32_slow(data.data() + start, size));
+		}
+	}
+	CHECK(crc32_calc(data.data(), data.size()) == crc32_slow(data.data(), data.size()));
+}
+
+static void test_incremental()
+{
+	const char* str = "The quick brown fox jumps over the lazy dog";
+	size_t size = strlen(str);
+	uint32_t crc = crc32_calc(str, 10);
+	crc = crc32_calc(str + 10, size - 10, crc);
+	CHECK(crc == 0x414fa339);
+	CHECK(crc == crc32_calc(str, size));
+}
+
+int main()
+{
+	RUN_TEST(test_known_values);
+	RUN_TEST(test_against_reference);
+	RUN_TEST(test_incremental);
+	return TEST_RESULT();
+}
@@ -0,0 +1,135 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for the dependency resolver
+  */
+
+#include <atomic>
+#include <vector>
+#include "dep_resolver.h"
+#include "test.h"
+
+// Adjacency list, with DEP_UNMET for dependencies that don't exist
+struct test_graph_t
+{
+	std::vector<std::vector<uint32_t>> edges;
+	std::vector<int> loads;
+	std::vector<std::atomic<int>> fetches;
+
+	explicit test_graph_t(std::vector<std::vector<uint32_t>> edges)
+		: edges(edges), loads(edges.size()), fetches(edges.size()) {}
+
+	dep_resolver_t resolver()
+	{
+		return dep_resolver_t(
+			[this](uint32_t node, std::vector<uint32_t>& deps) {
+				loads[node]++;
+				deps = this->edges[node];
+			},
+			[this](uint32_t node) { fetches[node]++; }
+		);
+	}
+};
+
+struct test_visit_t
+{
+	std::vector<uint32_t> emitted;
+	int unmet = 0;
+	std::vector<std::vector<uint32_t>> cycles;
+	dep_visitor_t visitor;
+
+	test_visit_t()
+	{
+		visitor.satisfied = [](uint32_t, size_t) { return false; };
+		visitor.follow = [](uint32_t, size_t, uint32_t) {};
+		visitor.unmet = [this](uint32_t, size_t) { unmet++; };
+		visitor.cycle = [this](const std::vector<uint32_t>& path) { cycles.push_back(path); };
+		visitor.emit = [this](uint32_t node) { emitted.push_back(node); };
+	}
+};
+
+static void test_post_order()
+{
+	// 0 -> 1 -> 3, 0 -> 2 -> 3
+	test_graph_t graph({ { 1, 2 }, { 3 }, { 3 }, {} });
+	dep_resolver_t resolver = graph.resolver();
+	test_visit_t visit;
+	CHECK(resolver.resolve(0, visit.visitor) == 0);
+	CHECK((visit.emitted == std::vector<uint32_t>{ 3, 1, 2, 0 }));
+	CHECK(graph.loads[3] == 1);
+
+	// Already emitted, so nothing happens
+	test_visit_t again;
+	CHECK(resolver.resolve(1, again.visitor) == 0);
+	CHECK(again.emitted.empty());
+	CHECK(resolver.emitted(3) && resolver.emitted(0));
+}
+
+static void test_unmet_and_cycle()
+{
+	// 0 -> 1 -> 2 -> 1, 0 -> unmet
+	test_graph_t graph({ { 1, DEP_UNMET }, { 2 }, { 1 } });
+	dep_resolver_t resolver = graph.resolver();
+	test_visit_t visit;
+	CHECK(resolver.resolve(0, visit.visitor) == 2);
+	CHECK(visit.unmet == 1);
+	CHECK(visit.cycles.size() == 1);
+	CHECK(!visit.cycles.empty() && (visit.cycles[0] == std::vector<uint32_t>{ 1, 2, 1 }));
+	// The cycle is broken, everything is still emitted
+	CHECK((visit.emitted == std::vector<uint32_t>{ 2, 1, 0 }));
+}
+
+static void test_deep_chain()
+{
+	// Would overflow the call stack of a recursive walk
+	const uint32_t DEPTH = 200000;
+	std::vector<std::vector<uint32_t>> edges(DEPTH);
+	for (uint32_t i = 0; i + 1 < DEPTH; i++) {
+		edges[i] = { i + 1 };
+	}
+	test_graph_t graph(edges);
+	dep_resolver_t resolver = graph.resolver();
+	test_visit_t visit;
+	CHECK(resolver.resolve(0, visit.visitor) == 0);
+	CHECK(visit.emitted.size() == DEPTH);
+	CHECK(!visit.emitted.empty() && visit.emitted.front() == DEPTH - 1 && visit.emitted.back() == 0);
+}
+
+static void test_prefetch()
+{
+	test_graph_t graph({ { 1, 2 }, { 3 }, { 3, DEP_UNMET }, {}, { 0 } });
+	dep_resolver_t resolver = graph.resolver();
+	resolver.prefetch({ 4, 0 }, 4);
+	for (size_t node = 0; node < graph.edges.size(); node++) {
+		CHECK(graph.fetches[node] == 1);
+		CHECK(graph.loads[node] == 1);
+	}
+	// Prefetching doesn't change the order
+	test_visit_t visit;
+	resolver.resolve(4, visit.visitor);
+	CHECK((visit.emitted == std::vector<uint32_t>{ 3, 1, 2, 0, 4 }));
+	CHECK(graph.fetches[3] == 1 && graph.loads[3] == 1);
+}
+
+static void test_satisfied()
+{
+	test_graph_t graph({ { 1, 2 }, {}, {} });
+	dep_resolver_t resolver = graph.resolver();
+	test_visit_t visit;
+	visit.visitor.satisfied = [](uint32_t node, size_t index) { return node == 0 && index == 1; };
+	resolver.resolve(0, visit.visitor);
+	CHECK((visit.emitted == std::vector<uint32_t>{ 1, 0 }));
+}
+
+int main()
+{
+	RUN_TEST(test_post_order);
+	RUN_TEST(test_unmet_and_cycle);
+	RUN_TEST(test_deep_chain);
+	RUN_TEST(test_prefetch);
+	RUN_TEST(test_satisfied);
+	return TEST_RESULT();
+}
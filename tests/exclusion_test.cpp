@@ -0,0 +1,64 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for exclusion sets
+  */
+
+#include "exclusion.h"
+#include "test.h"
+
+static void test_glob()
+{
+	CHECK(glob_t("th*prac").match("th06prac"));
+	CHECK(glob_t("th*prac").match("thprac"));
+	CHECK(!glob_t("th*prac").match("th06prac_extra"));
+	CHECK(glob_t("debug_*").match("debug_counters"));
+	CHECK(glob_t("th??").match("th18"));
+	CHECK(!glob_t("th??").match("th185"));
+	CHECK(glob_t("*a*b*").match("xaybz"));
+	CHECK(!glob_t("*a*b*").match("xbya"));
+	CHECK(glob_t("*").match(""));
+	CHECK(glob_t::is_pattern("a*") && glob_t::is_pattern("a?") && !glob_t::is_pattern("abc"));
+}
+
+static void test_set()
+{
+	exclusion_set_t set;
+	set.add("nmlgc");
+	set.add("th*prac");
+	CHECK(set.contains("nmlgc"));
+	CHECK(set.contains("th17prac"));
+	CHECK(!set.contains("thpatch"));
+
+	CHECK(!set.toggle("nmlgc"));
+	CHECK(!set.contains("nmlgc"));
+	CHECK(set.toggle("nmlgc"));
+	CHECK(set.contains("nmlgc"));
+
+	std::vector<std::string_view> entries = set.entries();
+	CHECK(entries.size() == 2);
+	CHECK(entries.size() == 2 && entries[0] == "th*prac" && entries[1] == "nmlgc");
+}
+
+static void test_copy()
+{
+	exclusion_set_t set;
+	set.add("a");
+	set.add("b*");
+	exclusion_set_t copy = set;
+	set.toggle("a");
+	CHECK(copy.contains("a"));
+	CHECK(copy.contains("bc"));
+	CHECK(!set.contains("a"));
+}
+
+int main()
+{
+	RUN_TEST(test_glob);
+	RUN_TEST(test_set);
+	RUN_TEST(test_copy);
+	return TEST_RESULT();
+}
@@ -0,0 +1,88 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for the streaming files.js scanner
+  */
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include "files_js.h"
+#include "test.h"
+
+static const char FILES_JS[] =
+	"{\n"
+	"  \"th06/stage1.msg.jdiff\": 305419896,\n"
+	"  \"global.js\": 4294967295,\n"
+	"  \"deleted.png\": null,\n"
+	"  \"esc\\\"aped.txt\": 1\n"
+	"}\n";
+
+struct entry_t
+{
+	std::string fn;
+	std::optional<uint32_t> crc32;
+	bool operator==(const entry_t& other) const { return fn == other.fn && crc32 == other.crc32; }
+};
+
+// Feeds [doc] in chunks of [chunk] bytes
+static bool scan(const char* doc, size_t chunk, std::vector<entry_t>& entries)
+{
+	files_js_scanner_t scanner([&](std::string_view fn, std::optional<uint32_t> crc32) {
+		entries.push_back({ std::string(fn), crc32 });
+		return true;
+	});
+	size_t size = strlen(doc);
+	for (size_t pos = 0; pos < size; pos += chunk) {
+		size_t n = std::min(chunk, size - pos);
+		if (scanner.feed(doc + pos, n) != n) {
+			break;
+		}
+	}
+	return scanner.finish();
+}
+
+static void test_entries()
+{
+	const std::vector<entry_t> expected = {
+		{ "th06/stage1.msg.jdiff", 305419896u },
+		{ "global.js", 4294967295u },
+		{ "deleted.png", std::nullopt },
+		{ "esc\"aped.txt", 1u },
+	};
+	// Chunk boundaries must not matter
+	for (size_t chunk : { 1, 2, 3, 7, 64, 4096 }) {
+		std::vector<entry_t> entries;
+		CHECK(scan(FILES_JS, chunk, entries));
+		CHECK(entries == expected);
+	}
+}
+
+static void test_stop()
+{
+	files_js_scanner_t scanner([](std::string_view fn) {
+		return fn != "global.js";
+	});
+	size_t size = strlen(FILES_JS);
+	CHECK(scanner.feed(FILES_JS, size) < size);
+	CHECK(scanner.stopped());
+	CHECK(scanner.finish());
+}
+
+static void test_invalid()
+{
+	std::vector<entry_t> entries;
+	CHECK(!scan("[1, 2, 3]", 4, entries));
+	CHECK(!scan("{\"a\": 1", 4, entries));
+}
+
+int main()
+{
+	RUN_TEST(test_entries);
+	RUN_TEST(test_stop);
+	RUN_TEST(test_invalid);
+	return TEST_RESULT();
+}
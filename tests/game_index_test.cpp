@@ -0,0 +1,150 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for the patch -> game index
+  */
+
+#include <string.h>
+#include "game_index.h"
+#include "transport_mock.h"
+#include "test.h"
+
+static game_set_t match(const game_table_t& games, const char* fn)
+{
+	game_set_t set;
+	games.match(fn, set);
+	return set;
+}
+
+static game_set_t only(const game_table_t& games, const char* game)
+{
+	game_set_t set;
+	set.set(games.find(game));
+	return set;
+}
+
+static void test_match()
+{
+	game_table_t games;
+	int th1 = games.add("th1");
+	CHECK(th1 >= 0);
+
+	// Game IDs that are prefixes of each other
+	CHECK(match(games, "th12/msg.msg") == only(games, "th12"));
+	CHECK(match(games, "th128/msg.msg") == only(games, "th128"));
+	CHECK(match(games, "th10/msg.msg") == only(games, "th10"));
+	CHECK(match(games, "th1/msg.msg") == only(games, "th1"));
+	CHECK(match(games, "th1x/msg.msg").none());
+
+	// Top-level game files, with and without a version
+	CHECK(match(games, "th17.js") == only(games, "th17"));
+	CHECK(match(games, "th12.js") == only(games, "th12"));
+	CHECK(match(games, "th128.js") == only(games, "th128"));
+	CHECK(match(games, "th17.v1.00b.js") == only(games, "th17"));
+
+	// Names without a slash
+	CHECK(match(games, "th06") == only(games, "th06"));
+	CHECK(match(games, "global.js").none());
+	CHECK(match(games, "readme").none());
+	CHECK(match(games, "").none());
+
+	// Only the first path component counts
+	CHECK(match(games, "global/th06/msg.msg").none());
+	CHECK(match(games, "th06/th07.js") == only(games, "th06"));
+}
+
+static void test_scan()
+{
+	const char* files_js = "{\"th06/a.msg\": 1, \"global.js\": 2, \"th17.js\": null}";
+	mock_transport_t mock({});
+	mock.add("https://b/lang/files.js", files_js);
+	transport_use(&mock);
+
+	game_table_t games;
+	game_index_entry_t entry;
+	// The first server doesn't have it
+	const char* servers[] = { "https://a/", "https://b/", nullptr };
+	CHECK(game_index_scan(servers, "lang", games, entry));
+	CHECK(entry.games[games.find("th06")]);
+	CHECK(entry.games[games.find("th17")]);
+	CHECK(entry.games.count() == 2);
+	CHECK(entry.files_js_hash == fnv1a64(files_js, strlen(files_js)));
+
+	const char* nowhere[] = { "https://a/", nullptr };
+	CHECK(!game_index_scan(nowhere, "lang", games, entry));
+	transport_use(nullptr);
+}
+
+static void test_refresh()
+{
+	mock_transport_t mock({});
+	mock.add("https://a/p1/files.js", "{\"th06/a.msg\": 1}");
+	mock.add("https://a/p2/files.js", "{\"th07/a.msg\": 1}");
+	transport_use(&mock);
+
+	const char* servers[] = { "https://a/", nullptr };
+	std::vector<game_index_source_t> sources = {
+		{ "a", "p1", "One", servers },
+		{ "a", "p2", nullptr, servers },
+		{ "a", "p3", nullptr, servers },
+	};
+	game_index_t index;
+	std::vector<size_t> stale = game_index_stale(index, sources, 1000, 100);
+	CHECK(stale.size() == 3);
+	game_index_update(index, sources, stale, 1000, 2);
+	// p3 has no files.js, so it stays out
+	CHECK(index.patches.size() == 2);
+	CHECK(index.patches["a/p2"].games[index.games.find("th07")]);
+
+	// Fresh until [max_age], or until the repo.js data changes
+	CHECK(game_index_stale(index, sources, 1050, 100) == std::vector<size_t>{ 2 });
+	CHECK(game_index_stale(index, sources, 1100, 100).size() == 3);
+	sources[0].title = "Renamed";
+	CHECK((game_index_stale(index, sources, 1050, 100) == std::vector<size_t>{ 0, 2 }));
+
+	catalog_t catalog;
+	catalog.add_patch(catalog.add_repo("a"), "p2");
+	catalog.finish();
+	game_index_prune(index, catalog);
+	CHECK(index.patches.size() == 1 && index.patches.count("a/p2"));
+	transport_use(nullptr);
+}
+
+static void test_observe()
+{
+	game_index_t index;
+	game_set_t th06;
+	th06.set(index.games.find("th06"));
+	game_index_entry_t& entry = index.patches["a/p1"];
+	entry.files_js_hash = 42;
+	entry.games = th06;
+	entry.checked = 1000;
+
+	// Same files.js
+	CHECK(!game_index_observe(index, "a/p1", 42, game_set_t(), 2000));
+	CHECK(index.patches["a/p1"].games == th06);
+
+	// The patch has added a game folder since it was indexed
+	game_set_t both = th06;
+	both.set(index.games.find("th07"));
+	CHECK(game_index_observe(index, "a/p1", 43, both, 2000));
+	CHECK(index.patches["a/p1"].games == both);
+	CHECK(index.patches["a/p1"].files_js_hash == 43);
+	CHECK(index.patches["a/p1"].checked == 2000);
+
+	// Not indexed
+	CHECK(!game_index_observe(index, "a/p2", 1, both, 2000));
+	CHECK(index.patches.size() == 1);
+}
+
+int main()
+{
+	RUN_TEST(test_match);
+	RUN_TEST(test_scan);
+	RUN_TEST(test_refresh);
+	RUN_TEST(test_observe);
+	return TEST_RESULT();
+}
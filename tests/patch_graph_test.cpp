@@ -0,0 +1,181 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for resolving the dependencies of rolled patches
+  */
+
+#include <string.h>
+#include <string>
+#include <vector>
+#include "patch_graph.h"
+#include "transport_mock.h"
+#include "test.h"
+
+static void test_parse()
+{
+	const char* doc =
+		"{"
+		"  \"id\": \"lang_en\","
+		"  \"dependencies\": [\"base_tsa\", \"nmlgc/script_latin\", \"\"],"
+		"  \"servers\": [\"https://a/\"]"
+		"}";
+	std::vector<patch_dependency_t> deps;
+	CHECK(patch_js_dependencies(doc, strlen(doc), deps));
+	CHECK(deps.size() == 2);
+	CHECK(deps.size() == 2 && deps[0].repo_id.empty() && deps[0].patch_id == "base_tsa");
+	CHECK(deps.size() == 2 && deps[1].repo_id == "nmlgc" && deps[1].patch_id == "script_latin");
+
+	deps.clear();
+	CHECK(patch_js_dependencies("{\"id\": \"x\"}", 11, deps));
+	CHECK(deps.empty());
+	CHECK(!patch_js_dependencies("{\"dependencies\": [", 18, deps));
+}
+
+// Repo "a" has p, q and cyc1; repo "b" has q, r and cyc2.
+struct graph_fixture_t
+{
+	mock_transport_t mock{ {} };
+	catalog_t catalog;
+	std::vector<std::vector<const char*>> servers = {
+		{ "https://a/", nullptr },
+		{ "https://dead/", "https://b/", nullptr },
+	};
+
+	graph_fixture_t()
+	{
+		uint32_t a = catalog.add_repo("a");
+		catalog.add_patch(a, "p");
+		catalog.add_patch(a, "q");
+		catalog.add_patch(a, "cyc1");
+		uint32_t b = catalog.add_repo("b");
+		catalog.add_patch(b, "q");
+		catalog.add_patch(b, "r");
+		catalog.add_patch(b, "cyc2");
+		catalog.finish();
+
+		// p needs its own q, r from wherever it is, and b's q explicitly
+		mock.add("https://a/p/patch.js", "{\"dependencies\": [\"q\", \"r\", \"b/q\", \"missing\"]}");
+		mock.add("https://a/q/patch.js", "{}");
+		mock.add("https://b/q/patch.js", "{}");
+		mock.add("https://b/r/patch.js", "{\"dependencies\": [\"b/q\"]}");
+		mock.add("https://a/cyc1/patch.js", "{\"dependencies\": [\"cyc2\"]}");
+		mock.add("https://b/cyc2/patch.js", "{\"dependencies\": [\"a/cyc1\"]}");
+		transport_use(&mock);
+	}
+
+	~graph_fixture_t()
+	{
+		transport_use(nullptr);
+	}
+
+	repo_servers_func_t servers_func()
+	{
+		return [this](uint32_t repo) { return servers[repo].data(); };
+	}
+};
+
+static std::string stack_str(const sel_stack_t& stack)
+{
+	std::string ret;
+	for (size_t i = 0; i < stack.size(); i++) {
+		ret += ret.empty() ? "" : " ";
+		ret += stack.repo_id(i);
+		ret += "/";
+		ret += stack.patch_id(i);
+	}
+	return ret;
+}
+
+static void test_resolve()
+{
+	graph_fixture_t f;
+	arena_t arena;
+	patch_graph_t graph(f.catalog, f.servers_func(), arena);
+	uint32_t p = graph.node("a", "p");
+	graph.prefetch({ p }, 4);
+	size_t requests = f.mock.stats().requests;
+
+	sel_stack_t stack;
+	std::vector<std::string> unmet;
+	std::string emitted;
+	patch_graph_visitor_t visitor;
+	visitor.unmet = [&](uint32_t node, const patch_dependency_t& dep) {
+		unmet.push_back(std::string(graph.patch_id(node)) + ":" + dep.patch_id);
+	};
+	visitor.emit = [&](uint32_t node) {
+		// Already on the stack by then
+		CHECK(stack.contains(graph.repo_id(node), graph.patch_id(node)));
+		emitted += graph.patch_id(node);
+	};
+	CHECK(graph.add(p, stack, visitor) == 1);
+	// Dependencies first. The first q is a's own, and the one r needs is
+	// b's, which "b/q" also asks for.
+	CHECK(stack_str(stack) == "a/q b/q b/r a/p");
+	CHECK(emitted == "qqrp");
+	CHECK(unmet.size() == 1 && unmet[0] == "p:missing");
+	// Everything was prefetched
+	CHECK(f.mock.stats().requests == requests);
+
+	CHECK(graph.patch_js(p) != nullptr);
+	CHECK(graph.dependencies(p).size() == 4);
+	const std::vector<uint32_t>& targets = graph.targets(p);
+	CHECK(targets.size() == 4);
+	CHECK(targets.size() == 4 && std::string(graph.repo_id(targets[1])) == "b");
+	CHECK(targets.size() == 4 && targets[3] == DEP_UNMET);
+
+	// Already on the stack
+	CHECK(graph.add(graph.node("b", "r"), stack, visitor) == 0);
+	CHECK(stack.size() == 4);
+}
+
+static void test_cycle()
+{
+	graph_fixture_t f;
+	arena_t arena;
+	patch_graph_t graph(f.catalog, f.servers_func(), arena);
+
+	sel_stack_t stack;
+	std::string cycle;
+	patch_graph_visitor_t visitor;
+	visitor.cycle = [&](const std::vector<uint32_t>& path) {
+		for (uint32_t node : path) {
+			cycle += graph.patch_id(node);
+			cycle += " ";
+		}
+	};
+	CHECK(graph.add(graph.node("a", "cyc1"), stack, visitor) == 1);
+	CHECK(cycle == "cyc1 cyc2 cyc1 ");
+}
+
+static void test_missing_patch_js()
+{
+	graph_fixture_t f;
+	arena_t arena;
+	patch_graph_t graph(f.catalog, f.servers_func(), arena);
+
+	// Not on any server, and a repo that isn't in the catalog
+	uint32_t gone = graph.node("b", "gone");
+	uint32_t unknown = graph.node("nowhere", "p");
+	graph.prefetch({ gone, unknown }, 2);
+	CHECK(graph.patch_js(gone) == nullptr);
+	CHECK(graph.patch_js(unknown) == nullptr);
+	CHECK(graph.dependencies(gone).empty());
+
+	sel_stack_t stack;
+	CHECK(graph.add(gone, stack, {}) == 0);
+	CHECK(stack_str(stack) == "b/gone");
+	CHECK(graph.node("b", "gone") == gone);
+	CHECK(graph.size() == 2);
+}
+
+int main()
+{
+	RUN_TEST(test_parse);
+	RUN_TEST(test_resolve);
+	RUN_TEST(test_cycle);
+	RUN_TEST(test_missing_patch_js);
+	return TEST_RESULT();
+}
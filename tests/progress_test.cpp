@@ -0,0 +1,113 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for progress reporting
+  */
+
+#include <thread>
+#include <vector>
+#include "progress.h"
+#include "test.h"
+
+static progress_event_t event(uint32_t group, uint32_t file, bool in_progress, uint64_t file_progress = 0)
+{
+	progress_event_t ret = {};
+	ret.group = group;
+	ret.file = file;
+	ret.source = 0;
+	ret.in_progress = in_progress;
+	ret.file_progress = file_progress;
+	return ret;
+}
+
+static void test_ring()
+{
+	progress_ring_t ring(3);
+	progress_event_t out;
+	CHECK(!ring.pop(out));
+	// Rounded up to 4, and wraps around
+	for (uint32_t round = 0; round < 3; round++) {
+		for (uint32_t i = 0; i < 4; i++) {
+			CHECK(ring.push(event(round, i, false)));
+		}
+		CHECK(!ring.push(event(round, 4, false)));
+		for (uint32_t i = 0; i < 4; i++) {
+			CHECK(ring.pop(out) && out.group == round && out.file == i);
+		}
+		CHECK(!ring.pop(out));
+	}
+}
+
+static void test_order()
+{
+	const unsigned PRODUCERS = 4;
+	const uint32_t EVENTS = 5000;
+	// Only touched by the reporter thread
+	std::vector<uint32_t> next(PRODUCERS);
+	size_t out_of_order = 0;
+	size_t received = 0;
+	{
+		// Small rings, so that producers have to wait for room
+		progress_reporter_t reporter(PRODUCERS, [&](const progress_event_t& e) {
+			out_of_order += e.file != next[e.group];
+			next[e.group] = e.file + 1;
+			received++;
+		}, std::chrono::hours(1), 64);
+		std::vector<std::thread> threads;
+		for (unsigned p = 0; p < PRODUCERS; p++) {
+			threads.emplace_back([&reporter, p] {
+				for (uint32_t i = 0; i < EVENTS; i++) {
+					reporter.push(p, event(p, i, false));
+				}
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+		reporter.stop();
+		CHECK(reporter.dropped() == 0);
+	}
+	CHECK(received == PRODUCERS * EVENTS);
+	CHECK(out_of_order == 0);
+}
+
+static void test_throttle()
+{
+	std::vector<progress_event_t> received;
+	{
+		progress_reporter_t reporter(1, [&](const progress_event_t& e) {
+			received.push_back(e);
+		}, std::chrono::milliseconds(0));
+		// The first one of a file only starts the clock
+		reporter.push(0, event(1, 1, true, 10));
+		reporter.push(0, event(1, 1, true, 20));
+		reporter.push(0, event(1, 1, false, 30));
+		// Starts over once the file has ended
+		reporter.push(0, event(1, 1, true, 40));
+	}
+	CHECK(received.size() == 2);
+	CHECK(received.size() == 2 && received[0].file_progress == 20 && received[1].file_progress == 30);
+
+	received.clear();
+	{
+		progress_reporter_t reporter(1, [&](const progress_event_t& e) {
+			received.push_back(e);
+		}, std::chrono::hours(1));
+		for (uint64_t i = 0; i < 100; i++) {
+			reporter.push(0, event(1, 1, true, i));
+		}
+		reporter.push(0, event(1, 1, false));
+	}
+	CHECK(received.size() == 1 && !received[0].in_progress);
+}
+
+int main()
+{
+	RUN_TEST(test_ring);
+	RUN_TEST(test_order);
+	RUN_TEST(test_throttle);
+	return TEST_RESULT();
+}
@@ -0,0 +1,73 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for repo discovery
+  */
+
+#include <string.h>
+#include <string>
+#include "repo_crawl.h"
+#include "transport_mock.h"
+#include "test.h"
+
+static void test_parse()
+{
+	const char* doc =
+		"{"
+		"  \"id\": \"nmlgc\","
+		"  \"title\": \"Nmlgc's patches\","
+		"  \"servers\": [\"https://a/nmlgc/\", \"https://b/nmlgc/\"],"
+		"  \"neighbors\": [\"https://a/thpatch\"],"
+		"  \"patches\": { \"base_tsa\": \"Base\", \"zzz\": null, \"aaa\": \"Last\" }"
+		"}";
+	repo_info_t repo;
+	CHECK(repo_info_parse(doc, strlen(doc), repo));
+	CHECK(repo.id == "nmlgc");
+	CHECK(repo.title == "Nmlgc's patches");
+	CHECK(repo.contact.empty());
+	CHECK(repo.servers.size() == 2 && repo.servers[1] == "https://b/nmlgc/");
+	CHECK(repo.neighbors.size() == 1);
+	// In document order, not sorted
+	CHECK(repo.patches.size() == 3);
+	CHECK(repo.patches.size() == 3 && repo.patches[0].id == "base_tsa" && repo.patches[0].title == "Base");
+	CHECK(repo.patches.size() == 3 && repo.patches[1].id == "zzz" && repo.patches[1].title.empty());
+	CHECK(repo.patches.size() == 3 && repo.patches[2].id == "aaa");
+
+	CHECK(!repo_info_parse("{\"title\": \"no ID\"}", 17, repo));
+	CHECK(!repo_info_parse("[]", 2, repo));
+}
+
+static void test_crawl()
+{
+	// a -> b, c; b -> a, d; c -> d, missing; d has the same ID as b
+	mock_transport_t mock({});
+	mock.add("https://a/repo.js", "{\"id\": \"a\", \"neighbors\": [\"https://b\", \"https://c/\"]}");
+	mock.add("https://b/repo.js", "{\"id\": \"b\", \"neighbors\": [\"https://a/\", \"https://d/\"]}");
+	mock.add("https://c/repo.js", "{\"id\": \"c\", \"neighbors\": [\"https://d/\", \"https://missing/\"]}");
+	mock.add("https://d/repo.js", "{\"id\": \"b\", \"neighbors\": [\"https://e/\"]}");
+	mock.add("https://e/repo.js", "{\"id\": \"e\"}");
+	transport_use(&mock);
+
+	std::vector<repo_info_t> repos = repo_crawl("https://a", 4);
+	std::string ids;
+	for (const repo_info_t& repo : repos) {
+		ids += repo.id;
+	}
+	// The duplicate isn't followed any further
+	CHECK(ids == "abc");
+	// Every URL is only requested once
+	CHECK(mock.stats().requests == 5);
+
+	CHECK(repo_crawl("https://missing/", 4).empty());
+	transport_use(nullptr);
+}
+
+int main()
+{
+	RUN_TEST(test_parse);
+	RUN_TEST(test_crawl);
+	return TEST_RESULT();
+}
@@ -0,0 +1,180 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for choosing the patches of a roll
+  */
+
+#include <set>
+#include <string>
+#include "roll.h"
+#include "test.h"
+
+static std::vector<roll_candidate_t> test_candidates()
+{
+	return {
+		{ 0, "nmlgc", "base_tsa" },
+		{ 0, "nmlgc", "th17prac" },
+		{ 1, "thpatch", "lang_en" },
+		{ 1, "thpatch", "lang_de" },
+		{ 2, "spam", "lang_en" },
+	};
+}
+
+static std::string ids(const std::vector<roll_candidate_t>& candidates)
+{
+	std::string ret;
+	for (const roll_candidate_t& c : candidates) {
+		ret += c.repo_id;
+		ret += '/';
+		ret += c.patch_id;
+		ret += ' ';
+	}
+	return ret;
+}
+
+static void test_exclude()
+{
+	std::vector<roll_candidate_t> candidates = test_candidates();
+	exclusion_set_t repo_exclude;
+	exclusion_set_t patch_exclude;
+	repo_exclude.add("spam");
+	patch_exclude.add("th*prac");
+	roll_exclude(candidates, repo_exclude, patch_exclude);
+	CHECK(ids(candidates) == "nmlgc/base_tsa thpatch/lang_en thpatch/lang_de ");
+}
+
+static void test_filter_game()
+{
+	game_index_t index;
+	int th17 = index.games.find("th17");
+	int th06 = index.games.find("th06");
+	index.patches["nmlgc/th17prac"].games.set(th17);
+	index.patches["thpatch/lang_en"].games.set(th17).set(th06);
+	index.patches["thpatch/lang_de"].games.set(th06);
+
+	std::vector<roll_candidate_t> candidates = test_candidates();
+	roll_filter_game(candidates, index, th17);
+	CHECK(ids(candidates) == "nmlgc/th17prac thpatch/lang_en ");
+
+	// A game that isn't in the table doesn't filter anything
+	candidates = test_candidates();
+	roll_filter_game(candidates, index, index.games.find("th999"));
+	CHECK(candidates.size() == test_candidates().size());
+}
+
+static void test_weights()
+{
+	roll_weights_t weights;
+	std::vector<roll_candidate_t> unweighted = test_candidates();
+	CHECK(roll_apply_weights(unweighted, weights).empty());
+	CHECK(unweighted.size() == 5);
+
+	weights.repos["thpatch"] = 2.0;
+	weights.patches["lang_en"] = 3.0;
+	weights.patches["thpatch/lang_de"] = 0.0;
+	CHECK(roll_weight(weights, "thpatch", "lang_en") == 6.0);
+	CHECK(roll_weight(weights, "spam", "lang_en") == 3.0);
+	CHECK(roll_weight(weights, "nmlgc", "base_tsa") == 1.0);
+
+	std::vector<roll_candidate_t> candidates = test_candidates();
+	std::vector<double> kept = roll_apply_weights(candidates, weights);
+	CHECK(ids(candidates) == "nmlgc/base_tsa nmlgc/th17prac thpatch/lang_en spam/lang_en ");
+	CHECK((kept == std::vector<double>{ 1.0, 1.0, 6.0, 3.0 }));
+}
+
+static void test_pick()
+{
+	for (bool weighted : { false, true }) {
+		std::vector<double> weights;
+		if (weighted) {
+			weights = { 1.0, 2.0, 3.0, 4.0, 5.0 };
+		}
+		std::vector<roll_candidate_t> a = test_candidates();
+		std::vector<roll_candidate_t> b = test_candidates();
+		rng_t rng_a(1234);
+		rng_t rng_b(1234);
+		roll_pick(a, weights, 3, rng_a);
+		roll_pick(b, weights, 3, rng_b);
+		CHECK(a.size() == 3);
+		// Same seed, same roll
+		CHECK(ids(a) == ids(b));
+		std::set<std::string> distinct;
+		for (const roll_candidate_t& c : a) {
+			distinct.insert(std::string(c.repo_id) + "/" + c.patch_id);
+		}
+		CHECK(distinct.size() == 3);
+	}
+
+	// A weight of 0 is never drawn
+	std::vector<roll_candidate_t> candidates = test_candidates();
+	rng_t rng(99);
+	roll_pick(candidates, { 0.0, 0.0, 1.0, 0.0, 1.0 }, 2, rng);
+	CHECK(ids(candidates) == "thpatch/lang_en spam/lang_en " || ids(candidates) == "spam/lang_en thpatch/lang_en ");
+}
+
+static void test_find_dependency()
+{
+	catalog_t catalog;
+	uint32_t nmlgc = catalog.add_repo("nmlgc");
+	catalog.add_patch(nmlgc, "base_tsa");
+	uint32_t thpatch = catalog.add_repo("thpatch");
+	catalog.add_patch(thpatch, "lang_en");
+	catalog.add_patch(thpatch, "base_tsa");
+	uint32_t spam = catalog.add_repo("spam");
+	catalog.add_patch(spam, "lang_en");
+	catalog.finish();
+
+	// Absolute
+	CHECK(roll_find_dependency(catalog, "spam", "thpatch", "lang_en") == thpatch);
+	CHECK(roll_find_dependency(catalog, "spam", "nmlgc", "lang_en") == CATALOG_NONE);
+	CHECK(roll_find_dependency(catalog, "spam", "missing", "lang_en") == CATALOG_NONE);
+	// Relative: own repo first, then the first repo that has it
+	CHECK(roll_find_dependency(catalog, "spam", nullptr, "lang_en") == spam);
+	CHECK(roll_find_dependency(catalog, "thpatch", nullptr, "base_tsa") == thpatch);
+	CHECK(roll_find_dependency(catalog, "spam", nullptr, "base_tsa") == nmlgc);
+	CHECK(roll_find_dependency(catalog, "missing", nullptr, "base_tsa") == nmlgc);
+	CHECK(roll_find_dependency(catalog, "spam", nullptr, "missing") == CATALOG_NONE);
+}
+
+static void test_runconfig()
+{
+	// What patch_to_runconfig_json() and json_dumps() give for a patch
+	// without any options
+	runconfig_patch_func_t entry = [](const char* repo_id, const char* patch_id) {
+		return std::string("{\"archive\": \"repos/") + repo_id + "/" + patch_id + "/\"}";
+	};
+	sel_stack_t stack;
+	CHECK(roll_runconfig_json(stack, "", entry) ==
+		"{\n"
+		"  \"console\": false,\n"
+		"  \"dat_dump\": false,\n"
+		"  \"patches\": []\n"
+		"}");
+
+	stack.push("nmlgc", "base_tsa");
+	stack.push("thpatch", "lang_en");
+	CHECK(roll_runconfig_json(stack, "th17\"\t", entry) ==
+		"{\n"
+		"  \"console\": false,\n"
+		"  \"dat_dump\": false,\n"
+		"  \"game\": \"th17\\\"\\t\",\n"
+		"  \"patches\": [\n"
+		"    {\"archive\": \"repos/nmlgc/base_tsa/\"},\n"
+		"    {\"archive\": \"repos/thpatch/lang_en/\"}\n"
+		"  ]\n"
+		"}");
+}
+
+int main()
+{
+	RUN_TEST(test_exclude);
+	RUN_TEST(test_filter_game);
+	RUN_TEST(test_weights);
+	RUN_TEST(test_pick);
+	RUN_TEST(test_find_dependency);
+	RUN_TEST(test_runconfig);
+	return TEST_RESULT();
+}
@@ -0,0 +1,385 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for downloading the files of a rolled patch stack
+  */
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "crc32.h"
+#include "game_index.h"
+#include "roll_update.h"
+#include "transport_mock.h"
+#include "test.h"
+
+namespace fs = std::filesystem;
+
+static std::string crc(const std::string& str)
+{
+	return std::to_string(crc32_calc(str.data(), str.size()));
+}
+
+static std::string temp_dir(const char* name)
+{
+	fs::path dir = fs::temp_directory_path() / name;
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	return dir.string() + "/";
+}
+
+static std::string read_str(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return "(missing)";
+	}
+	return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static roll_update_patch_t make_patch(const std::string& dir, const char* id, std::vector<std::string> servers)
+{
+	roll_update_patch_t p;
+	p.id = id;
+	p.archive = dir + id + "/";
+	p.servers = std::move(servers);
+	return p;
+}
+
+// Patches "x" and "y" both have "a.txt" and "empty.txt" with the same
+// CRC32. "y" also has "b.txt" at another path with the same content as
+// "x"'s "a.txt", a file with the wrong CRC32 on its server, and deletes
+// "old.txt".
+static void add_patches(mock_transport_t& mock)
+{
+	mock.add("https://x/files.js",
+		"{\"a.txt\": " + crc("shared") + ", \"empty.txt\": " + crc("") + "}");
+	mock.add("https://x/a.txt", "shared");
+	mock.add("https://x/empty.txt", "");
+	mock.add("https://y/files.js",
+		"{\"a.txt\": " + crc("shared") + ", \"b.txt\": " + crc("shared") +
+		", \"empty.txt\": " + crc("") + ", \"bad.txt\": " + crc("good") +
+		", \"old.txt\": null}");
+	mock.add("https://y/a.txt", "shared");
+	mock.add("https://y/b.txt", "shared");
+	mock.add("https://y/empty.txt", "");
+	mock.add("https://y/bad.txt", "corrupted");
+}
+
+// Remembers the order in which URLs were requested
+struct recording_transport_t : public transport_t
+{
+	transport_t& inner;
+	std::mutex mutex;
+	std::vector<std::string> urls;
+
+	explicit recording_transport_t(transport_t& inner) : inner(inner) {}
+
+	HttpStatus stream(const char* url, const download_chunk_func_t& on_chunk) override
+	{
+		{
+			std::scoped_lock lock(mutex);
+			urls.push_back(url);
+		}
+		return inner.stream(url, on_chunk);
+	}
+
+	std::vector<std::string> snapshot()
+	{
+		std::scoped_lock lock(mutex);
+		return urls;
+	}
+};
+
+static size_t url_index(const std::vector<std::string>& urls, const std::string& url)
+{
+	for (size_t i = 0; i < urls.size(); i++) {
+		if (urls[i] == url) {
+			return i;
+		}
+	}
+	return urls.size();
+}
+
+static bool has_current(const roll_update_patch_t& p, const char* fn, bool deleted)
+{
+	for (const auto& [current_fn, crc32] : p.current) {
+		if (current_fn == fn) {
+			return crc32.has_value() != deleted;
+		}
+	}
+	return false;
+}
+
+static void test_update()
+{
+	std::string dir = temp_dir("roulette_roll_update_test");
+	mock_transport_t mock({});
+	add_patches(mock);
+	transport_use(&mock);
+
+	std::vector<roll_update_patch_t> stack;
+	stack.push_back(make_patch(dir, "x", { "https://x/" }));
+	stack.push_back(make_patch(dir, "y", { "https://dead/", "https://y/" }));
+	stack.push_back(make_patch(dir, "z", { "https://dead/" }));
+	fs::create_directories(dir + "y");
+	std::ofstream(dir + "y/old.txt") << "old";
+
+	size_t crc_errors = 0;
+	roll_update_t update;
+	update.jobs = 2;
+	update.progress_callback = [&](const roll_progress_status_t& status) {
+		if (status.status == ROLL_FILE_CRC32_ERROR) {
+			crc_errors++;
+			CHECK(std::string(status.url) == "https://y/bad.txt");
+		}
+		return true;
+	};
+	roll_update_stats_t stats = roll_update(stack, update);
+
+	CHECK(read_str(dir + "x/a.txt") == "shared");
+	CHECK(read_str(dir + "y/a.txt") == "shared");
+	CHECK(read_str(dir + "y/b.txt") == "shared");
+	CHECK(read_str(dir + "x/empty.txt") == "");
+	CHECK(read_str(dir + "y/empty.txt") == "");
+	CHECK(read_str(dir + "y/bad.txt") == "(missing)");
+	CHECK(!fs::exists(dir + "y/old.txt"));
+
+	// a.txt and empty.txt are downloaded once and copied, but b.txt has
+	// another path, so it isn't taken for the same file.
+	CHECK(stats.files == 7);
+	CHECK(stats.downloaded == 3);
+	CHECK(stats.deduplicated == 2);
+	// bad.txt, and z's files.js
+	CHECK(stats.failed == 2);
+	CHECK(crc_errors == 1);
+
+	CHECK(stack[0].listed && stack[1].listed && !stack[2].listed);
+	CHECK(stack[0].current.size() == 2);
+	CHECK(has_current(stack[1], "b.txt", false));
+	CHECK(has_current(stack[1], "old.txt", true));
+	CHECK(!has_current(stack[1], "bad.txt", false));
+	CHECK(stack[2].current.empty());
+	// No game table, so nothing is classified
+	CHECK(stack[1].games.none());
+
+	// Nothing is downloaded again
+	size_t requests = mock.stats().requests;
+	stats = roll_update(stack, update);
+	CHECK(stats.downloaded == 0);
+	CHECK(stats.deduplicated == 0);
+	// Only the files.js and bad.txt, from every server that is tried
+	CHECK(mock.stats().requests - requests == 6);
+
+	transport_use(nullptr);
+	fs::remove_all(dir);
+}
+
+static void test_filter_and_store()
+{
+	std::string dir = temp_dir("roulette_roll_update_store_test");
+	blob_store_t store(dir + "store", 1 << 20);
+	store.load();
+	mock_transport_t mock({});
+	add_patches(mock);
+	transport_use(&mock);
+
+	std::vector<roll_update_patch_t> stack;
+	stack.push_back(make_patch(dir, "x", { "https://x/" }));
+	roll_update_t update;
+	update.filter = [](const char* fn) {
+		return strcmp(fn, "a.txt") == 0;
+	};
+	update.store = &store;
+	game_table_t games;
+	update.games = &games;
+	update.game_bit = games.find("th06");
+	roll_update_stats_t stats = roll_update(stack, update);
+	CHECK(stats.files == 1);
+	// Hashed and classified whether or not the filter let the files through
+	std::string files_js = "{\"a.txt\": " + crc("shared") + ", \"empty.txt\": " + crc("") + "}";
+	CHECK(stack[0].files_js_hash == fnv1a64(files_js.data(), files_js.size()));
+	CHECK(stack[0].games.none());
+	CHECK(stats.downloaded == 1);
+	CHECK(!fs::exists(dir + "x/empty.txt"));
+
+	// Taken from the store instead of the server
+	fs::remove(dir + "x/a.txt");
+	size_t requests = mock.stats().requests;
+	stats = roll_update(stack, update);
+	CHECK(stats.downloaded == 0);
+	CHECK(stats.restored == 1);
+	CHECK(read_str(dir + "x/a.txt") == "shared");
+	CHECK(mock.stats().requests - requests == 1);
+
+	// Any other patch with the same file gets it from the store, too
+	stack[0] = make_patch(dir, "y", { "https://y/" });
+	requests = mock.stats().requests;
+	stats = roll_update(stack, update);
+	CHECK(stats.downloaded == 0);
+	CHECK(stats.restored == 1);
+	CHECK(read_str(dir + "y/a.txt") == "shared");
+	CHECK(mock.stats().requests - requests == 1);
+
+	transport_use(nullptr);
+	fs::remove_all(dir);
+}
+
+// th06's own files and the global ones come first when rolling for th06,
+// even though files.js lists the others before them.
+static void add_game_patch(mock_transport_t& mock)
+{
+	mock.add("https://g/files.js",
+		"{\"th07/fill.txt\": " + crc("f1") + ", \"th08.js\": " + crc("f2") +
+		", \"th06/launch.txt\": " + crc("l1") + ", \"global.txt\": " + crc("l2") +
+		", \"th06.js\": " + crc("l3") + "}");
+	mock.add("https://g/th07/fill.txt", "f1");
+	mock.add("https://g/th08.js", "f2");
+	mock.add("https://g/th06/launch.txt", "l1");
+	mock.add("https://g/global.txt", "l2");
+	mock.add("https://g/th06.js", "l3");
+}
+
+static void test_launch_priority()
+{
+	const char* launch[] = { "th06/launch.txt", "global.txt", "th06.js" };
+	const char* fill[] = { "th07/fill.txt", "th08.js" };
+	game_table_t games;
+
+	for (unsigned jobs : { 1, 4 }) {
+		std::string dir = temp_dir("roulette_roll_update_launch_test");
+		mock_transport_t mock({});
+		add_game_patch(mock);
+		recording_transport_t recorder(mock);
+		transport_use(&recorder);
+
+		std::vector<roll_update_patch_t> stack;
+		stack.push_back(make_patch(dir, "g", { "https://g/" }));
+		roll_update_t update;
+		update.jobs = jobs;
+		update.games = &games;
+		update.game_bit = games.find("th06");
+		size_t calls = 0;
+		size_t failed = SIZE_MAX;
+		std::vector<std::string> urls_at_launch;
+		update.on_launchable = [&](size_t launch_failed) {
+			calls++;
+			failed = launch_failed;
+			urls_at_launch = recorder.snapshot();
+			for (const char* fn : launch) {
+				CHECK(read_str(dir + "g/" + fn) != "(missing)");
+			}
+		};
+		roll_update_stats_t stats = roll_update(stack, update);
+		CHECK(stats.downloaded == 5);
+		CHECK(calls == 1);
+		CHECK(failed == 0);
+
+		std::vector<std::string> urls = recorder.snapshot();
+		CHECK(urls.size() == 6);
+		for (const char* launch_fn : launch) {
+			std::string launch_url = std::string("https://g/") + launch_fn;
+			CHECK(url_index(urls_at_launch, launch_url) < urls_at_launch.size());
+			for (const char* fill_fn : fill) {
+				CHECK(url_index(urls, launch_url) < url_index(urls, std::string("https://g/") + fill_fn));
+			}
+		}
+		if (jobs == 1) {
+			// Nothing else has started yet
+			CHECK(urls_at_launch.size() == 4);
+		}
+
+		transport_use(nullptr);
+		fs::remove_all(dir);
+	}
+}
+
+static void test_launch_nothing_needed()
+{
+	std::string dir = temp_dir("roulette_roll_update_launch_none_test");
+	mock_transport_t mock({});
+	mock.add("https://g/files.js",
+		"{\"th07/fill.txt\": " + crc("f1") + ", \"th08.js\": " + crc("f2") + "}");
+	mock.add("https://g/th07/fill.txt", "f1");
+	mock.add("https://g/th08.js", "f2");
+	recording_transport_t recorder(mock);
+	transport_use(&recorder);
+
+	std::vector<roll_update_patch_t> stack;
+	stack.push_back(make_patch(dir, "g", { "https://g/" }));
+	game_table_t games;
+	roll_update_t update;
+	update.games = &games;
+	update.game_bit = games.find("th06");
+	size_t calls = 0;
+	size_t failed = SIZE_MAX;
+	std::vector<std::string> urls_at_launch;
+	update.on_launchable = [&](size_t launch_failed) {
+		calls++;
+		failed = launch_failed;
+		urls_at_launch = recorder.snapshot();
+	};
+	roll_update_stats_t stats = roll_update(stack, update);
+	CHECK(stats.downloaded == 2);
+	CHECK(calls == 1);
+	CHECK(failed == 0);
+	// Before any file was downloaded
+	CHECK(urls_at_launch.size() == 1 && urls_at_launch[0] == "https://g/files.js");
+
+	transport_use(nullptr);
+	fs::remove_all(dir);
+}
+
+static void test_launch_failures()
+{
+	std::string dir = temp_dir("roulette_roll_update_launch_fail_test");
+	mock_transport_t mock({});
+	mock.add("https://g/files.js",
+		"{\"th06/bad.txt\": " + crc("good") + ", \"th06/gone.txt\": " + crc("gone") +
+		", \"global.txt\": " + crc("l2") + ", \"th07/bad.txt\": " + crc("good") + "}");
+	mock.add("https://g/th06/bad.txt", "corrupted");
+	mock.add("https://g/global.txt", "l2");
+	mock.add("https://g/th07/bad.txt", "corrupted");
+	transport_use(&mock);
+
+	std::vector<roll_update_patch_t> stack;
+	stack.push_back(make_patch(dir, "g", { "https://g/" }));
+	// No files.js at all, so none of its files can be there
+	stack.push_back(make_patch(dir, "z", { "https://dead/" }));
+	game_table_t games;
+	roll_update_t update;
+	update.games = &games;
+	update.game_bit = games.find("th06");
+	size_t calls = 0;
+	size_t failed = SIZE_MAX;
+	update.on_launchable = [&](size_t launch_failed) {
+		calls++;
+		failed = launch_failed;
+	};
+	roll_update_stats_t stats = roll_update(stack, update);
+	CHECK(calls == 1);
+	// th06/bad.txt, th06/gone.txt, and z's files.js, but not th07/bad.txt
+	CHECK(failed == 3);
+	CHECK(stats.downloaded == 1);
+	CHECK(stats.failed == 4);
+
+	transport_use(nullptr);
+	fs::remove_all(dir);
+}
+
+int main()
+{
+	RUN_TEST(test_update);
+	RUN_TEST(test_filter_and_store);
+	RUN_TEST(test_launch_priority);
+	RUN_TEST(test_launch_nothing_needed);
+	RUN_TEST(test_launch_failures);
+	return TEST_RESULT();
+}
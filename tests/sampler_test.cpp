@@ -0,0 +1,93 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for seeded random sampling
+  */
+
+#include <set>
+#include "sampler.h"
+#include "test.h"
+
+static void test_rng()
+{
+	rng_t a(42);
+	rng_t b(42);
+	rng_t c(43);
+	bool differs = false;
+	for (int i = 0; i < 100; i++) {
+		uint64_t x = a.next();
+		CHECK(x == b.next());
+		differs |= x != c.next();
+	}
+	CHECK(differs);
+
+	for (int i = 0; i < 10000; i++) {
+		CHECK(a.below(7) < 7);
+		double u = a.unit();
+		CHECK(u >= 0.0 && u < 1.0);
+	}
+}
+
+static void test_sample_to_front()
+{
+	std::vector<int> items;
+	for (int i = 0; i < 100; i++) {
+		items.push_back(i);
+	}
+	rng_t rng(1);
+	sample_to_front(items, 10, rng);
+	std::set<int> all(items.begin(), items.end());
+	CHECK(all.size() == 100);
+	std::set<int> front(items.begin(), items.begin() + 10);
+	CHECK(front.size() == 10);
+
+	// More than there are just takes everything
+	std::vector<int> few = { 1, 2, 3 };
+	sample_to_front(few, 10, rng);
+	CHECK(few.size() == 3);
+}
+
+static void test_alias_table()
+{
+	const double weights[] = { 1.0, 0.0, 3.0 };
+	alias_table_t table;
+	CHECK(table.build(weights, 3) == 4.0);
+	rng_t rng(7);
+	size_t counts[3] = {};
+	for (int i = 0; i < 40000; i++) {
+		counts[table.draw(rng)]++;
+	}
+	CHECK(counts[1] == 0);
+	// 1:3, with plenty of slack
+	CHECK(counts[0] > 8000 && counts[0] < 12000);
+	CHECK(counts[2] > 28000 && counts[2] < 32000);
+}
+
+static void test_weighted_sampler()
+{
+	std::vector<double> weights(1000, 1.0);
+	weights[500] = 0.0;
+	weighted_sampler_t sampler(weights);
+	CHECK(sampler.total() == 999.0);
+	rng_t rng(3);
+	std::set<size_t> drawn;
+	for (int i = 0; i < 999; i++) {
+		size_t idx = sampler.draw(rng);
+		CHECK(idx < 1000 && idx != 500);
+		CHECK(drawn.insert(idx).second);
+		sampler.remove(idx);
+	}
+	CHECK(sampler.draw(rng) == SIZE_MAX);
+}
+
+int main()
+{
+	RUN_TEST(test_rng);
+	RUN_TEST(test_sample_to_front);
+	RUN_TEST(test_alias_table);
+	RUN_TEST(test_weighted_sampler);
+	return TEST_RESULT();
+}
@@ -0,0 +1,47 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for the selection stack
+  */
+
+#include <string.h>
+#include "sel_stack.h"
+#include "test.h"
+
+static void test_matching()
+{
+	sel_stack_t stack;
+	stack.push("nmlgc", "base_tsa");
+	stack.push(nullptr, "lang_en");
+
+	CHECK(stack.contains("nmlgc", "base_tsa"));
+	CHECK(!stack.contains("thpatch", "base_tsa"));
+	// Without a repo, a patch from any repo matches
+	CHECK(stack.contains(nullptr, "base_tsa"));
+	// An entry without a repo matches every repo
+	CHECK(stack.contains("thpatch", "lang_en"));
+	CHECK(stack.contains(nullptr, "lang_en"));
+	CHECK(!stack.contains(nullptr, "lang_de"));
+}
+
+static void test_order()
+{
+	sel_stack_t stack;
+	stack.push("nmlgc", "base_tsa");
+	stack.push(nullptr, "lang_en");
+	stack.push("thpatch", "lang_de");
+	CHECK(stack.size() == 3);
+	CHECK(strcmp(stack.repo_id(0), "nmlgc") == 0 && strcmp(stack.patch_id(0), "base_tsa") == 0);
+	CHECK(stack.repo_id(1) == nullptr && strcmp(stack.patch_id(1), "lang_en") == 0);
+	CHECK(strcmp(stack.repo_id(2), "thpatch") == 0 && strcmp(stack.patch_id(2), "lang_de") == 0);
+}
+
+int main()
+{
+	RUN_TEST(test_matching);
+	RUN_TEST(test_order);
+	return TEST_RESULT();
+}
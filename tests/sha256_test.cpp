@@ -0,0 +1,51 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for SHA-256
+  */
+
+#include <string.h>
+#include <string>
+#include "sha256.h"
+#include "test.h"
+
+static std::string sha256_str(const std::string& str)
+{
+	return sha256_hex(sha256_calc(str.data(), str.size()));
+}
+
+static void test_known_values()
+{
+	CHECK(sha256_str("") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	CHECK(sha256_str("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	CHECK(sha256_str("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") == "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+	CHECK(sha256_str(std::string(1000000, 'a')) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+static void test_padding_boundaries()
+{
+	// The length has to go into a second block from 56 bytes on
+	CHECK(sha256_str(std::string(55, 'x')) != sha256_str(std::string(56, 'x')));
+	CHECK(sha256_str(std::string(64, 'a')) == "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb");
+}
+
+static void test_hex_round_trip()
+{
+	sha256_t hash = sha256_calc("abc", 3);
+	sha256_t parsed = {};
+	CHECK(sha256_parse(sha256_hex(hash).c_str(), parsed));
+	CHECK(parsed == hash);
+	CHECK(!sha256_parse("ba7816bf", parsed));
+	CHECK(!sha256_parse(std::string(64, 'g').c_str(), parsed));
+}
+
+int main()
+{
+	RUN_TEST(test_known_values);
+	RUN_TEST(test_padding_boundaries);
+	RUN_TEST(test_hex_round_trip);
+	return TEST_RESULT();
+}
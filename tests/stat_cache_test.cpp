@@ -0,0 +1,143 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for the cache of local file CRC32s
+  */
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "stat_cache.h"
+#include "test.h"
+
+namespace fs = std::filesystem;
+
+static std::string temp_dir(const char* name)
+{
+	fs::path dir = fs::temp_directory_path() / name;
+	fs::remove_all(dir);
+	fs::create_directories(dir);
+	return dir.string() + "/";
+}
+
+// Same size and time as roll_update passes to the cache
+static void stat_file(const std::string& path, uint64_t& size, uint64_t& mtime)
+{
+	size = fs::file_size(path);
+	mtime = (uint64_t)fs::last_write_time(path).time_since_epoch().count();
+}
+
+static void test_lookup()
+{
+	std::string dir = temp_dir("roulette_stat_cache_test");
+	std::string path = dir + "a.txt";
+	std::ofstream(path) << "abc";
+
+	stat_cache_t cache;
+	uint64_t size, mtime;
+	uint32_t crc32 = 0;
+	stat_file(path, size, mtime);
+	CHECK(!cache.lookup(path, size, mtime, crc32));
+	cache.store(path, size, mtime, 0x12345678);
+	CHECK(cache.lookup(path, size, mtime, crc32));
+	CHECK(crc32 == 0x12345678);
+
+	// Touched, but with the same size
+	fs::last_write_time(path, fs::last_write_time(path) + std::chrono::seconds(2));
+	uint64_t touched_size, touched_mtime;
+	stat_file(path, touched_size, touched_mtime);
+	CHECK(touched_size == size);
+	CHECK(!cache.lookup(path, touched_size, touched_mtime, crc32));
+	// Rewritten with another size
+	std::ofstream(path) << "abcd";
+	stat_file(path, touched_size, touched_mtime);
+	CHECK(!cache.lookup(path, touched_size, mtime, crc32));
+
+	CHECK(!cache.lookup(dir + "b.txt", size, mtime, crc32));
+	CHECK(cache.hits() == 1);
+	CHECK(cache.misses() == 4);
+	fs::remove_all(dir);
+}
+
+static void test_round_trip()
+{
+	std::string dir = temp_dir("roulette_stat_cache_save_test");
+	std::string fn = dir + "stat_cache.txt";
+	{
+		stat_cache_t cache;
+		cache.store("th06/a.txt", 3, 100, 0xdeadbeef);
+		cache.store("path with spaces.txt", 0, 200, 0);
+		CHECK(cache.save(fn.c_str()));
+		// Replaces the previous file
+		cache.store("th07/b.txt", 5, 300, 1);
+		CHECK(cache.save(fn.c_str()));
+	}
+	CHECK(!fs::exists(fn + ".tmp"));
+
+	stat_cache_t cache;
+	CHECK(cache.load(fn.c_str()));
+	uint32_t crc32 = 0;
+	CHECK(cache.lookup("th06/a.txt", 3, 100, crc32) && crc32 == 0xdeadbeef);
+	CHECK(cache.lookup("path with spaces.txt", 0, 200, crc32) && crc32 == 0);
+	CHECK(cache.lookup("th07/b.txt", 5, 300, crc32) && crc32 == 1);
+	CHECK(!cache.lookup("th06/a.txt", 3, 101, crc32));
+	fs::remove_all(dir);
+}
+
+static void test_expiry()
+{
+	std::string dir = temp_dir("roulette_stat_cache_expiry_test");
+	std::string fn = dir + "stat_cache.txt";
+	stat_cache_t cache(1);
+	cache.store("old.txt", 1, 1, 1);
+	cache.store("used.txt", 2, 2, 2);
+	uint32_t crc32;
+	for (int i = 0; i < 3; i++) {
+		CHECK(cache.lookup("used.txt", 2, 2, crc32));
+		CHECK(cache.save(fn.c_str()));
+	}
+	CHECK(!cache.lookup("old.txt", 1, 1, crc32));
+	CHECK(cache.lookup("used.txt", 2, 2, crc32));
+	fs::remove_all(dir);
+}
+
+static void test_corrupt()
+{
+	std::string dir = temp_dir("roulette_stat_cache_corrupt_test");
+	std::string fn = dir + "stat_cache.txt";
+	uint32_t crc32;
+
+	// Not even a generation
+	std::ofstream(fn) << "garbage\n";
+	stat_cache_t cache;
+	CHECK(!cache.load(fn.c_str()));
+	CHECK(!cache.lookup("a.txt", 3, 100, crc32));
+
+	// Truncated in the middle of the second entry, and one broken line
+	std::ofstream(fn, std::ios::binary) <<
+		"5\n"
+		"0000000a 3 64 5 a.txt\n"
+		"not an entry\n"
+		"0000000b 3 64 5";
+	CHECK(cache.load(fn.c_str()));
+	CHECK(cache.lookup("a.txt", 3, 100, crc32) && crc32 == 10);
+	CHECK(!cache.lookup("b.txt", 3, 100, crc32));
+
+	// Missing
+	CHECK(!cache.load((dir + "missing.txt").c_str()));
+	CHECK(!cache.lookup("a.txt", 3, 100, crc32));
+	fs::remove_all(dir);
+}
+
+int main()
+{
+	RUN_TEST(test_lookup);
+	RUN_TEST(test_round_trip);
+	RUN_TEST(test_expiry);
+	RUN_TEST(test_corrupt);
+	return TEST_RESULT();
+}
@@ -0,0 +1,30 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Minimal test harness
+  */
+
+#pragma once
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+// Keeps going after a failure, so that one run shows all of them.
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		test_failures++; \
+	} \
+} while (0)
+
+#define RUN_TEST(func) do { \
+	int failures_before = test_failures; \
+	func(); \
+	printf("%s %s\n", test_failures == failures_before ? "PASS" : "FAIL", #func); \
+} while (0)
+
+#define TEST_RESULT() (test_failures ? 1 : 0)
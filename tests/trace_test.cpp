@@ -0,0 +1,87 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for trace recording
+  */
+
+#include <string>
+#include <thread>
+#include <vector>
+#include "trace.h"
+#include "test.h"
+
+static size_t count(const std::string& str, const char* needle)
+{
+	size_t ret = 0;
+	for (size_t pos = str.find(needle); pos != std::string::npos; pos = str.find(needle, pos + 1)) {
+		ret++;
+	}
+	return ret;
+}
+
+static void test_disabled()
+{
+	{
+		trace_span_t span("before");
+		CHECK(!span.recording());
+		span.arg("key", "value");
+	}
+	trace_start();
+	std::string json = trace_stop();
+	CHECK(json.find("before") == std::string::npos);
+	CHECK(count(json, "\"ph\"") == 0);
+
+	// Still open when recording stopped
+	trace_start();
+	trace_span_t open("open");
+	CHECK(open.recording());
+	json = trace_stop();
+	CHECK(json.find("open") == std::string::npos);
+}
+
+static void test_spans()
+{
+	trace_start();
+	{
+		trace_span_t outer("outer", "test");
+		outer.arg("url", "https://a/\"quoted\"\\");
+		outer.arg("bytes", (int64_t)1234);
+		std::vector<std::thread> threads;
+		for (int i = 0; i < 4; i++) {
+			threads.emplace_back([] {
+				for (int j = 0; j < 10; j++) {
+					trace_span_t span("inner");
+				}
+			});
+		}
+		for (std::thread& thread : threads) {
+			thread.join();
+		}
+	}
+	std::string json = trace_stop();
+	CHECK(count(json, "\"name\":\"inner\"") == 40);
+	CHECK(count(json, "\"name\":\"outer\"") == 1);
+	CHECK(json.find("\"cat\":\"test\"") != std::string::npos);
+	CHECK(json.find("\"args\":{\"url\":\"https://a/\\\"quoted\\\"\\\\\",\"bytes\":1234}") != std::string::npos);
+	CHECK(json.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0);
+	// Every thread gets its own track
+	size_t tids = 0;
+	for (int tid = 1; tid < 16; tid++) {
+		tids += json.find("\"tid\":" + std::to_string(tid) + ",") != std::string::npos;
+	}
+	CHECK(tids == 5);
+
+	// Recorded events are only returned once
+	trace_start();
+	CHECK(count(trace_stop(), "\"ph\"") == 0);
+}
+
+int main()
+{
+	RUN_TEST(test_disabled);
+	RUN_TEST(test_spans);
+	return TEST_RESULT();
+}
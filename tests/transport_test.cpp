@@ -0,0 +1,129 @@
+/**
+  * Touhou Community Reliant Automatic Patcher
+  * Roulette
+  *
+  * ----
+  *
+  * Tests for the local mirror and the simulated network
+  */
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include "transport_mirror.h"
+#include "transport_mock.h"
+#include "test.h"
+
+static std::string body_string(const std::vector<uint8_t>& body)
+{
+	return std::string(body.begin(), body.end());
+}
+
+static void test_mirror()
+{
+	std::filesystem::path root = std::filesystem::temp_directory_path() / "roulette_transport_test";
+	std::filesystem::create_directories(root / "srv.example.net" / "lang_en");
+	std::ofstream(root / "srv.example.net" / "lang_en" / "patch 1.js", std::ios::binary) << "{}";
+	std::string root_str = root.string();
+
+	for (const std::string& root_arg : { root_str, "file://" + root_str + "/" }) {
+		mirror_transport_t mirror(root_arg);
+		transport_use(&mirror);
+		std::vector<uint8_t> body;
+		CHECK(download_to_memory("https://srv.example.net/lang_en/patch%201.js?nocache=1", body) == HttpOk);
+		CHECK(body_string(body) == "{}");
+		CHECK(download_to_memory("https://srv.example.net/lang_en/missing.js", body) == HttpClientError);
+		CHECK(download_to_memory("https://srv.example.net/lang_en", body) == HttpClientError);
+		CHECK(download_to_memory("https://srv.example.net/../secret", body) == HttpClientError);
+		CHECK(mirror.path_for("https://srv.example.net/a/..x") != "");
+	}
+	transport_use(nullptr);
+	std::filesystem::remove_all(root);
+}
+
+static void test_mock_bodies()
+{
+	mock_transport_t mock({});
+	mock.add("https://a/x", { 'h', 'i' });
+	std::vector<uint8_t> big(100000, 'z');
+	mock.add("https://a/big", big);
+	transport_use(&mock);
+
+	std::vector<uint8_t> body;
+	CHECK(download_to_memory("https://a/x", body) == HttpOk && body_string(body) == "hi");
+	CHECK(download_to_memory("https://a/big", body) == HttpOk && body == big);
+	CHECK(download_to_memory("https://a/missing", body) == HttpClientError);
+	size_t chunks = 0;
+	CHECK(download_stream("https://a/big", [&](const uint8_t*, size_t) { return ++chunks < 2; }) == HttpCancelled);
+
+	mock_transport_t::stats_t stats = mock.stats();
+	CHECK(stats.requests == 4);
+	CHECK(stats.failed == 1);
+	transport_use(nullptr);
+}
+
+static void test_mock_errors()
+{
+	// Same seed, same failures, no matter the order of the requests
+	mock_transport_options_t options;
+	options.error_rate = 0.5;
+	options.seed = 5;
+	mock_transport_t a(options);
+	mock_transport_t b(options);
+	std::vector<uint8_t> body;
+	std::vector<HttpStatus> forward;
+	std::vector<HttpStatus> backward(20);
+	for (int i = 0; i < 20; i++) {
+		std::string url = "https://a/" + std::to_string(i);
+		a.add(url, { 1 });
+		b.add(url, { 1 });
+	}
+	transport_use(&a);
+	for (int i = 0; i < 20; i++) {
+		forward.push_back(download_to_memory(("https://a/" + std::to_string(i)).c_str(), body));
+	}
+	transport_use(&b);
+	for (int i = 19; i >= 0; i--) {
+		backward[i] = download_to_memory(("https://a/" + std::to_string(i)).c_str(), body);
+	}
+	CHECK(forward == backward);
+	size_t failed = a.stats().failed;
+	CHECK(failed > 0 && failed < 20);
+
+	// Retries get another roll of the dice
+	options.error_rate = 1.0;
+	mock_transport_t always(options);
+	always.add("https://a/x", { 1 });
+	transport_use(&always);
+	CHECK(download_to_memory("https://a/x", body) == HttpServerError);
+	transport_use(nullptr);
+}
+
+static void test_mock_timing()
+{
+	using clock = std::chrono::steady_clock;
+	mock_transport_options_t options;
+	options.latency_ms = 20.0;
+	options.bandwidth = 1000000.0;
+	mock_transport_t mock(options);
+	mock.add("https://a/x", std::vector<uint8_t>(100000));
+	transport_use(&mock);
+
+	std::vector<uint8_t> body;
+	clock::time_point start = clock::now();
+	CHECK(download_to_memory("https://a/x", body) == HttpOk);
+	double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+	// 20 ms of latency plus 100 ms of transfer
+	CHECK(ms >= 115.0);
+	transport_use(nullptr);
+}
+
+int main()
+{
+	RUN_TEST(test_mirror);
+	RUN_TEST(test_mock_bodies);
+	RUN_TEST(test_mock_errors);
+	RUN_TEST(test_mock_timing);
+	return TEST_RESULT();
+}